@@ -0,0 +1,81 @@
+#ifndef __AHO_CORASICK_H
+#define __AHO_CORASICK_H
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/common.h"
+#include "core/re.h"
+#include "core/table.h"
+
+namespace parsergen::dfa {
+
+// Aho-Corasick automaton for rule sets that are plain strings, built
+// straight from the sorted keywords without Thompson or subset
+// construction. The trie lives in a double array: the child of state s on
+// byte c is base[s] + c iff check[base[s] + c] == s. Missing children fall
+// back along the fail links at search time.
+class AhoCorasick {
+ public:
+  static constexpr u32 ROOT = 0;
+  static constexpr u32 NONE = -1;
+
+  // the rule whose keyword is exactly sv, the lowest id on duplicates
+  std::optional<u32> accept(std::string_view sv) const;
+  // same semantics as Searcher::find and Searcher::find_all
+  std::optional<Match> find(std::string_view sv, size_t pos = 0) const;
+  std::vector<Match> find_all(std::string_view sv) const;
+  // every occurrence of every keyword, overlapping ones included, in order
+  // of their end
+  void for_each_match(std::string_view sv,
+                      const std::function<void(const Match&)>& fn) const;
+
+  u32 state_num() const { return state_count; }
+  size_t memory() const {
+    return (base.size() + check.size() + fail.size() + out_link.size() +
+            depth.size() + output.size()) *
+           sizeof(u32);
+  }
+
+  // keyword i gets terminal id i
+  static AhoCorasick from_literals(const std::vector<std::string_view>& words);
+  // nothing unless every rule only matches one fixed string
+  static std::optional<AhoCorasick> from_re(
+      const std::vector<std::unique_ptr<re::Re>>& res);
+  // the fixed string of every rule, nothing if one has several
+  static std::optional<std::vector<std::string>> literals_of(
+      const std::vector<std::unique_ptr<re::Re>>& res);
+
+ private:
+  u32 child(u32 state, u8 c) const {
+    u32 t = base[state] + c;
+    return t < check.size() && check[t] == state ? t : NONE;
+  }
+  u32 next(u32 state, u8 c) const {
+    for (;;) {
+      if (u32 t = child(state, c); t != NONE) return t;
+      if (state == ROOT) return ROOT;
+      state = fail[state];
+    }
+  }
+
+  u32 state_count = 0;
+  // indexed by slot, a slot is a state iff its check is not NONE
+  std::vector<u32> base;
+  std::vector<u32> check;
+  std::vector<u32> fail;
+  // the nearest state on the fail chain with an output, or NONE
+  std::vector<u32> out_link;
+  // length of the keyword prefix a state stands for
+  std::vector<u32> depth;
+  // the rule id ending at the state, or NONE
+  std::vector<u32> output;
+};
+
+}  // namespace parsergen::dfa
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef __BYTE_CLASS_H
+#define __BYTE_CLASS_H
+
+#include <array>
+#include <vector>
+
+#include "core/common.h"
+#include "core/re.h"
+
+namespace parsergen {
+
+// Partition of the 256 byte values into equivalence classes: bytes of the
+// same class are never separated by any transition, so automata only need
+// one column per class instead of one per byte.
+struct ByteClasses {
+  // map[byte] is the class of byte, classes are numbered by their first byte
+  std::array<u8, 256> map;
+  u32 num;
+
+  // every byte in one class
+  ByteClasses() : num(1) { map.fill(0); }
+
+  // split classes so that bytes with different keys are never together
+  void refine(const std::array<u32, 256>& key);
+  void refine(const ByteClasses& other);
+
+  // the smallest byte of every class, indexed by class
+  std::vector<u8> representatives() const;
+  // all bytes of every class, indexed by class
+  std::vector<std::vector<u8>> members() const;
+
+  // each char set leaf ([...], \d, a single char) of the regex separates its
+  // bytes from the others
+  static ByteClasses from_re(const re::Re& re);
+};
+
+}  // namespace parsergen
+
+#endif
@@ -2,11 +2,13 @@
 #define __DFA_H
 
 #include <bitset>
+#include <map>
 #include <optional>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "core/byte_class.h"
 #include "core/common.h"
 #include "core/nfa.h"
 #include "core/re.h"
@@ -15,14 +17,51 @@ namespace parsergen::dfa {
 
 using DfaNode = std::pair<std::optional<u32>, std::unordered_map<u8, u32>>;
 
+// The distinct sets of rules that accepting states accept for, numbered in
+// the order they are found. A dfa built with one labels an accepting state
+// with the number of its set instead of the lowest rule, so a single walk
+// gives every rule matching the input.
+class RuleSets {
+ public:
+  // the label of ids, a new one when no set so far equals it. ids are
+  // sorted and unique.
+  u32 intern(std::vector<u32>&& ids);
+  const std::vector<u32>& operator[](u32 label) const { return sets[label]; }
+  u32 size() const { return (u32)sets.size(); }
+  size_t memory() const { return cost(ids_num); }
+  // what interning ids adds to memory() at most
+  static size_t cost(const std::vector<u32>& ids) { return cost(ids.size()); }
+  void clear() {
+    sets.clear();
+    labels.clear();
+    ids_num = 0;
+  }
+
+ private:
+  // a set is stored twice, as a key and as a value
+  static size_t cost(size_t ids_num) { return ids_num * 2 * sizeof(u32); }
+
+  std::vector<std::vector<u32>> sets;
+  std::map<std::vector<u32>, u32> labels;
+  size_t ids_num = 0;
+};
+
 struct Dfa {
+  // the most nodes minimize() and the subset construction handle
+  static constexpr u32 MAX_STATES = 1023;
+
   std::vector<DfaNode> nodes;
-  explicit Dfa(std::vector<DfaNode>&& nodes) : nodes(std::move(nodes)) {}
-  Dfa(const Dfa& d) : nodes(d.nodes) {}
-  Dfa(Dfa&& d) : nodes(std::move(d.nodes)) {}
+  // every node maps all bytes of one class to the same target
+  ByteClasses classes;
+  explicit Dfa(std::vector<DfaNode>&& nodes)
+      : nodes(std::move(nodes)), classes(byte_classes(this->nodes)) {}
+  Dfa(std::vector<DfaNode>&& nodes, ByteClasses classes)
+      : nodes(std::move(nodes)), classes(std::move(classes)) {}
+  Dfa(const Dfa& d) : nodes(d.nodes), classes(d.classes) {}
+  Dfa(Dfa&& d) : nodes(std::move(d.nodes)), classes(std::move(d.classes)) {}
 
   // if ret_val.has_value() / if (ret_val) it is accepted
-  std::optional<u32> accept(std::string_view sv) {
+  std::optional<u32> accept(std::string_view sv) const {
     assert(nodes.size() >= 1);
     u32 cur_idx = 0;
     auto terminal = std::get<0>(nodes[0]);
@@ -43,9 +82,18 @@ struct Dfa {
   void remove_dead_state();
   void minimize();
 
+  // the coarsest classes of the given nodes
+  static ByteClasses byte_classes(const std::vector<DfaNode>& nodes);
+
   static Dfa from_sv(std::string_view sv, u32 id = 0);
   static Dfa from_re(std::unique_ptr<re::Re> re, u32 id = 0);
   static Dfa from_nfa(nfa::Nfa&& nfa);
+  // nothing instead of exiting when the nfa has more than 1024 nodes or the
+  // subset construction needs more than max_states states. With sets, the
+  // accepting states are labelled by the sets of rules they accept for.
+  static std::optional<Dfa> try_from_nfa(const nfa::Nfa& nfa,
+                                         u32 max_states = MAX_STATES,
+                                         RuleSets* sets = nullptr);
 };
 
 void bfs(Dfa& dfa, std::function<void(u32, DfaNode&)> fn);
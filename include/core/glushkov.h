@@ -0,0 +1,190 @@
+#ifndef __GLUSHKOV_H
+#define __GLUSHKOV_H
+
+#include <array>
+#include <bitset>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "core/common.h"
+#include "core/re.h"
+#include "core/table.h"
+
+namespace parsergen::nfa {
+
+// The Glushkov automaton of a rule set: one position per char set leaf of
+// the regexes ([...], \d, a single char), and a position is active exactly
+// when its leaf read the last byte. There are no epsilon edges, so a step
+// is "every follower of an active position that accepts the byte".
+struct Positions {
+  std::vector<std::bitset<256>> bytes;
+  std::vector<std::vector<u32>> follow;
+  // the positions that can read the first byte of a match
+  std::vector<u32> first;
+  // the lowest rule id a match can end at a position with
+  std::vector<std::optional<u32>> terminal;
+  // the lowest rule id matching the empty string
+  std::optional<u32> empty;
+
+  u32 size() const { return (u32)bytes.size(); }
+
+  // rule i gets terminal id i
+  static Positions from_re(const std::vector<std::unique_ptr<re::Re>>& res);
+};
+
+// Runs a Glushkov automaton of at most 64 * W positions with all of its
+// states in W machine words. A step is one table lookup per nonzero byte of
+// the active mask, or-ed together, then an and with the positions of the
+// byte read. Linear in the input whatever the subset construction would
+// have made of the rules.
+template <u32 W>
+class BitParallel {
+ public:
+  using Mask = std::array<u64, W>;
+  static constexpr u32 MAX_POSITIONS = 64 * W;
+
+  std::optional<u32> accept(std::string_view sv) const {
+    if (sv.empty()) return empty;
+    Mask d = and_of(first, bytes[(u8)sv[0]]);
+    for (size_t i = 1; i < sv.size() && any(d); ++i) d = step(d, sv[i]);
+    return terminal_of(d);
+  }
+
+  std::optional<dfa::Token> scan(std::string_view sv, size_t pos) const {
+    std::optional<dfa::Token> token;
+    if (empty) token = dfa::Token{*empty, pos, 0};
+    if (pos == sv.size()) return token;
+    Mask d = and_of(first, bytes[(u8)sv[pos]]);
+    for (size_t i = pos + 1;; ++i) {
+      if (!any(d)) break;
+      if (auto id = terminal_of(d)) token = dfa::Token{*id, pos, i - pos};
+      if (i == sv.size()) break;
+      d = step(d, sv[i]);
+    }
+    return token;
+  }
+
+  static BitParallel from_positions(const Positions& positions) {
+    assert(positions.size() <= MAX_POSITIONS);
+    BitParallel bp;
+    bp.bytes.assign(256, Mask{});
+    bp.follow.assign(W * 8 * 256, Mask{});
+    bp.terminal = positions.terminal;
+    bp.terminal.resize(MAX_POSITIONS);
+    bp.empty = positions.empty;
+    for (auto p : positions.first) set(bp.first, p);
+    for (u32 p = 0; p < positions.size(); ++p) {
+      for (u32 c = 0; c < 256; ++c) {
+        if (positions.bytes[p][c]) set(bp.bytes[c], p);
+      }
+      if (positions.terminal[p]) set(bp.finals, p);
+    }
+    // follow[chunk * 256 + bits] is the union over the positions chunk * 8 + k
+    // with bit k of bits set, built from the entries with one bit less
+    for (u32 chunk = 0; chunk < W * 8; ++chunk) {
+      Mask* table = &bp.follow[chunk * 256];
+      for (u32 bits = 1; bits < 256; ++bits) {
+        u32 k = __builtin_ctz(bits);
+        u32 p = chunk * 8 + k;
+        Mask single{};
+        if (p < positions.size()) {
+          for (auto q : positions.follow[p]) set(single, q);
+        }
+        table[bits] = or_of(table[bits & (bits - 1)], single);
+      }
+    }
+    return bp;
+  }
+
+ private:
+  static void set(Mask& m, u32 p) { m[p / 64] |= u64(1) << (p % 64); }
+  static bool any(const Mask& m) {
+    u64 x = 0;
+    for (u32 w = 0; w < W; ++w) x |= m[w];
+    return x != 0;
+  }
+  static Mask and_of(const Mask& a, const Mask& b) {
+    Mask m;
+    for (u32 w = 0; w < W; ++w) m[w] = a[w] & b[w];
+    return m;
+  }
+  static Mask or_of(const Mask& a, const Mask& b) {
+    Mask m;
+    for (u32 w = 0; w < W; ++w) m[w] = a[w] | b[w];
+    return m;
+  }
+
+  Mask step(const Mask& d, u8 c) const {
+    Mask next{};
+    for (u32 w = 0; w < W; ++w) {
+      u64 word = d[w];
+      for (u32 chunk = w * 8; word; ++chunk, word >>= 8) {
+        if (u32 bits = word & 0xff) {
+          const Mask& f = follow[chunk * 256 + bits];
+          for (u32 v = 0; v < W; ++v) next[v] |= f[v];
+        }
+      }
+    }
+    return and_of(next, bytes[c]);
+  }
+
+  std::optional<u32> terminal_of(const Mask& d) const {
+    std::optional<u32> id;
+    for (u32 w = 0; w < W; ++w) {
+      for (u64 bits = d[w] & finals[w]; bits; bits &= bits - 1) {
+        auto t = terminal[w * 64 + __builtin_ctzll(bits)];
+        if (!id || *t < *id) id = t;
+      }
+    }
+    return id;
+  }
+
+  Mask first{};
+  Mask finals{};
+  // the positions reading each byte
+  std::vector<Mask> bytes;
+  std::vector<Mask> follow;
+  std::vector<std::optional<u32>> terminal;
+  std::optional<u32> empty;
+};
+
+// BitParallel in one, four or eight words, whichever the rules fit
+class Glushkov {
+ public:
+  static constexpr u32 MAX_POSITIONS = BitParallel<8>::MAX_POSITIONS;
+
+  // same semantics as Dfa::accept and dfa::scan
+  std::optional<u32> accept(std::string_view sv) const {
+    return std::visit([sv](const auto& bp) { return bp.accept(sv); }, impl);
+  }
+  std::optional<dfa::Token> scan(std::string_view sv, size_t pos = 0) const {
+    return std::visit([sv, pos](const auto& bp) { return bp.scan(sv, pos); },
+                      impl);
+  }
+
+  // the number of words per mask
+  u32 words() const {
+    return std::visit([](const auto& bp) { return bp.MAX_POSITIONS / 64; },
+                      impl);
+  }
+
+  // nothing when sv is not a valid pattern or has more than MAX_POSITIONS
+  // positions
+  static std::optional<Glushkov> from_sv(std::string_view sv, u32 id = 0);
+  static std::optional<Glushkov> from_re(
+      const std::vector<std::unique_ptr<re::Re>>& res);
+  static std::optional<Glushkov> from_positions(const Positions& positions);
+
+ private:
+  using Impl = std::variant<BitParallel<1>, BitParallel<4>, BitParallel<8>>;
+  explicit Glushkov(Impl&& impl) : impl(std::move(impl)) {}
+
+  Impl impl;
+};
+
+}  // namespace parsergen::nfa
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef __HYBRID_H
+#define __HYBRID_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "core/common.h"
+#include "core/dfa.h"
+#include "core/lazy_dfa.h"
+#include "core/nfa.h"
+#include "core/re.h"
+#include "core/table.h"
+
+namespace parsergen::dfa {
+
+struct Budget {
+  // dfa states the eager subset construction may build
+  u32 max_states = Dfa::MAX_STATES;
+  // bytes of the lazy dfa cache once the eager one gave up
+  size_t cache_size = LazyDfa::DEFAULT_CACHE_SIZE;
+};
+
+// One matcher for patterns of unknown size: the full compiled dfa when it
+// fits the budget, otherwise a simulation of the nfa that determinizes on
+// the fly into a bounded cache. Neither way exits the process or grows past
+// the budget, whatever the pattern.
+class Hybrid {
+ public:
+  // not const: the lazy engine builds its states while it matches, so like
+  // a LazyDfa one instance is only used by one thread at a time
+  std::optional<u32> accept(std::string_view sv) {
+    return std::visit([sv](auto& e) { return e.accept(sv); }, engine);
+  }
+  std::optional<Token> scan(std::string_view sv, size_t pos = 0) {
+    return std::visit([sv, pos](auto& e) { return e.scan(sv, pos); }, engine);
+  }
+
+  // whether the full dfa fit
+  bool is_dfa() const { return std::holds_alternative<CompiledDfa>(engine); }
+  size_t memory() const {
+    return std::visit([](const auto& e) { return e.memory(); }, engine);
+  }
+
+  // std::nullopt when sv is not a valid pattern
+  static std::optional<Hybrid> from_sv(std::string_view sv, u32 id = 0,
+                                       Budget budget = {});
+  static Hybrid from_re(std::unique_ptr<re::Re> re, u32 id = 0,
+                        Budget budget = {});
+  static Hybrid from_re(std::vector<std::unique_ptr<re::Re>>&& res,
+                        Budget budget = {});
+  static Hybrid from_nfa(nfa::Nfa&& nfa, Budget budget = {});
+
+ private:
+  using Engine = std::variant<CompiledDfa, LazyDfa>;
+  explicit Hybrid(Engine&& engine) : engine(std::move(engine)) {}
+
+  Engine engine;
+};
+
+}  // namespace parsergen::dfa
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef __LAZY_DFA_H
+#define __LAZY_DFA_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "core/byte_class.h"
+#include "core/common.h"
+#include "core/dfa.h"
+#include "core/nfa.h"
+#include "core/re.h"
+#include "core/table.h"
+
+namespace parsergen::dfa {
+
+// Subset construction on demand: a dfa state and its row are only built
+// the first time a scan reaches them, and kept in a cache of bounded size.
+// When the next state does not fit anymore the whole cache is flushed and
+// the scan carries on from a fresh copy of its current state. Patterns whose
+// full dfa would be huge run at dfa speed over the part of it the input
+// actually visits, with the memory of one compiled regex capped.
+class LazyDfa {
+ public:
+  static constexpr u32 DEAD_STATE = 0;
+  static constexpr u32 START_STATE = 1;
+  static constexpr size_t DEFAULT_CACHE_SIZE = 1 << 20;
+
+  // sets holds pointers into ids
+  LazyDfa(const LazyDfa&) = delete;
+  LazyDfa(LazyDfa&&) = default;
+
+  // same semantics as Dfa::accept and dfa::scan on a compiled table. Both
+  // grow or flush the cache, so one instance is only ever used by one
+  // thread at a time; threads that search concurrently each build their
+  // own from the same nfa.
+  std::optional<u32> accept(std::string_view sv);
+  std::optional<Token> scan(std::string_view sv, size_t pos = 0);
+
+  // states in the cache right now, the dead and start state included
+  u32 state_num() const { return (u32)sets.size(); }
+  // the bytes charged to the cache, never above the budget for long
+  size_t memory() const { return used; }
+  // how often the cache was full
+  size_t flushes() const { return flush_count; }
+
+  // the budget is in bytes, at least the dead, start and current state are
+  // always kept whatever it is
+  static LazyDfa from_sv(std::string_view sv, u32 id = 0,
+                         size_t cache_size = DEFAULT_CACHE_SIZE);
+  static LazyDfa from_re(std::unique_ptr<re::Re> re, u32 id = 0,
+                         size_t cache_size = DEFAULT_CACHE_SIZE);
+  static LazyDfa from_re(std::vector<std::unique_ptr<re::Re>>&& res,
+                         size_t cache_size = DEFAULT_CACHE_SIZE);
+  static LazyDfa from_nfa(nfa::Nfa&& nfa,
+                          size_t cache_size = DEFAULT_CACHE_SIZE);
+  // states are labelled by the sets of rules they accept for, see rules().
+  // The sets are part of the cache, charged to it and flushed with it, but
+  // for the set of the token a scan() is about to return.
+  static LazyDfa from_nfa_sets(nfa::Nfa&& nfa,
+                               size_t cache_size = DEFAULT_CACHE_SIZE);
+
+  // the rules of a label accept() or scan() just returned, only for a dfa
+  // from from_nfa_sets()
+  const std::vector<u32>& rules(u32 label) const {
+    return (*rule_sets)[label];
+  }
+
+ private:
+  static constexpr u32 UNKNOWN = -1;
+
+  // sorted nfa states
+  using Set = std::vector<u32>;
+  struct SetHash {
+    size_t operator()(const Set& s) const {
+      size_t h = s.size();
+      for (auto idx : s) h = h * 31 + idx;
+      return h;
+    }
+  };
+
+  LazyDfa(nfa::Nfa&& nfa, size_t cache_size, bool label_sets);
+
+  u32 next(u32 state, u8 c) {
+    u32 t = trans[state * nfa.classes.num + nfa.classes.map[c]];
+    return t != UNKNOWN ? t : build(state, c);
+  }
+  // computes, caches and returns the target of state on c
+  u32 build(u32 state, u8 c);
+  // the index of set, added if new. May flush, which invalidates every
+  // other index but DEAD_STATE and START_STATE.
+  u32 add_state(Set&& set);
+  void flush();
+  // the e-closure of the states in set, sorted
+  Set closure(Set set);
+  size_t cost(const Set& set) const {
+    return nfa.classes.num * sizeof(u32) + set.size() * 2 * sizeof(u32) +
+           STATE_OVERHEAD;
+  }
+  static constexpr size_t STATE_OVERHEAD = 64;
+
+  nfa::Nfa nfa;
+  size_t cache_size;
+  // empty when a state is labelled by its lowest rule
+  std::optional<RuleSets> rule_sets;
+  // the label of the token scan() holds, flush() keeps its rules
+  std::optional<u32> kept;
+  Set start;
+
+  // row major, nfa.classes.num entries per state, UNKNOWN until built
+  std::vector<u32> trans;
+  std::vector<std::optional<u32>> terminals;
+  // the key of every state in ids, node based so the pointers stay valid
+  std::vector<const Set*> sets;
+  std::unordered_map<Set, u32, SetHash> ids;
+  size_t used = 0;
+  size_t flush_count = 0;
+
+  // scratch for closure(), mark[idx] == epoch when idx is already in
+  std::vector<u32> mark;
+  u32 epoch = 0;
+};
+
+}  // namespace parsergen::dfa
+
+#endif
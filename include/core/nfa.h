@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "core/byte_class.h"
 #include "core/common.h"
 #include "core/re.h"
 
@@ -14,6 +15,9 @@ struct NfaNode {
   std::optional<u32> terminal_id;
   std::vector<u32> eps_edges;
   std::unordered_map<u8, std::vector<u32>> edges;
+  // entering the node records the position in this capture slot, group k
+  // opens at slot 2k and closes at 2k + 1
+  std::optional<u32> tag;
 
   NfaNode(std::optional<u32> terminal_id, std::vector<u32> eps_edges,
           std::unordered_map<u8, std::vector<u32>> edges)
@@ -32,9 +36,21 @@ struct NfaNode {
 struct Nfa {
   // nodes[0] is the start
   std::vector<NfaNode> nodes;
-  explicit Nfa(std::vector<NfaNode>&& nodes) : nodes(std::move(nodes)) {}
-  Nfa(const Nfa& d) : nodes(d.nodes) {}
-  Nfa(Nfa&& d) : nodes(std::move(d.nodes)) {}
+  // bytes of one class lead every nfa state set to equivalent sets
+  ByteClasses classes;
+  explicit Nfa(std::vector<NfaNode>&& nodes)
+      : nodes(std::move(nodes)), classes(byte_classes(this->nodes)) {}
+  Nfa(std::vector<NfaNode>&& nodes, ByteClasses classes)
+      : nodes(std::move(nodes)), classes(std::move(classes)) {}
+  Nfa(const Nfa& d) : nodes(d.nodes), classes(d.classes) {}
+  Nfa(Nfa&& d) : nodes(std::move(d.nodes)), classes(std::move(d.classes)) {}
+
+  // exact per node classes, finer than the ones derived from a regex
+  static ByteClasses byte_classes(const std::vector<NfaNode>& nodes);
+
+  // accepts the reversed strings, every edge is flipped and the old start
+  // becomes the only terminal with the given id
+  Nfa reverse(u32 id = 0) const;
 
   static Nfa from_sv(std::string_view sv, u32 id = 0);
   static Nfa from_re(std::unique_ptr<re::Re> re, u32 id = 0);
@@ -0,0 +1,26 @@
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+#include <string_view>
+#include <vector>
+
+#include "core/common.h"
+#include "core/table.h"
+
+namespace parsergen::dfa {
+
+// CompiledDfa::tokenize() on several threads. Every chunk of sv but the
+// first is tokenized speculatively as if a token started at its first
+// byte. The chunks are then stitched in order: the true token stream is
+// continued serially from where the previous chunk left it until it lands
+// on a token boundary of the speculative stream, from there on both agree.
+// Once the true stream went through a whole chunk out of step the rest is
+// tokenized serially, so the work stays linear in sv.size(). The chunks run
+// on a pool of workers kept across calls. threads = 0 uses every hardware
+// thread, small inputs stay on one.
+size_t tokenize_parallel(const CompiledDfa& dfa, std::string_view sv,
+                         std::vector<Token>& tokens, u32 threads = 0);
+
+}  // namespace parsergen::dfa
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __PIKE_VM_H
+#define __PIKE_VM_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "core/common.h"
+#include "core/nfa.h"
+#include "core/re.h"
+#include "core/table.h"
+#include "core/tdfa.h"
+
+namespace parsergen::nfa {
+
+// Runs the nfa directly, all live threads in lockstep over the input: no
+// subset construction or minimization, O(sv.size() * nodes.size()) per
+// search. Every thread carries the position its match attempt started at,
+// so unlike a dfa it knows where a match begins without a second pass.
+// Threads live in two sparse sets sized once per search, a step allocates
+// nothing. captures() also gives every thread a slot per group boundary.
+class PikeVm {
+ public:
+  // same semantics as Dfa::accept, dfa::scan and Searcher
+  std::optional<u32> accept(std::string_view sv) const;
+  std::optional<dfa::Token> scan(std::string_view sv, size_t pos = 0) const;
+  std::optional<dfa::Match> find(std::string_view sv, size_t pos = 0) const;
+  std::vector<dfa::Match> find_all(std::string_view sv) const;
+  // same semantics as TaggedDfa::match: threads are kept in priority order
+  // and the first one of the lowest rule accepting at the end wins
+  std::optional<u32> captures(std::string_view sv,
+                              std::vector<dfa::Span>& spans) const;
+
+  u32 group_num() const { return groups; }
+
+  static PikeVm from_sv(std::string_view sv, u32 id = 0);
+  static PikeVm from_re(std::unique_ptr<re::Re> re, u32 id = 0);
+  static PikeVm from_re(std::vector<std::unique_ptr<re::Re>>&& res);
+  static PikeVm from_nfa(Nfa&& nfa) { return PikeVm(std::move(nfa)); }
+
+ private:
+  explicit PikeVm(Nfa&& nfa);
+
+  // nfa states in insertion order, with O(1) insert, lookup and clear
+  // without initializing the sparse side
+  struct Threads {
+    std::vector<u32> dense;
+    std::vector<u32> sparse;
+    u32 size = 0;
+    // start[idx] is where the attempt of the thread at idx began
+    std::vector<size_t> start;
+    // slots[idx * 2 * groups + t] is the position of boundary t of the thread
+    // at idx, only for captures()
+    std::vector<size_t> slots;
+
+    explicit Threads(size_t n, size_t slot_num = 0)
+        : dense(n), sparse(n), start(n), slots(n * slot_num) {}
+    bool contains(u32 idx) const {
+      return sparse[idx] < size && dense[sparse[idx]] == idx;
+    }
+  };
+  // adds idx and its e-closure, a state already there keeps its thread
+  void add(Threads& threads, u32 idx, size_t start,
+           std::vector<u32>& stack) const;
+  // adds idx and its e-closure in priority order, scratch holds the slots
+  // of the path to idx and is the same again on return
+  void add_captures(Threads& threads, u32 idx, size_t pos,
+                    std::vector<size_t>& scratch,
+                    std::vector<std::pair<u32, size_t>>& stack) const;
+  // the leftmost-longest match from pos on, anchored at pos or not
+  std::optional<dfa::Match> run(std::string_view sv, size_t pos,
+                                bool anchored) const;
+
+  Nfa nfa;
+  u32 groups = 0;
+};
+
+}  // namespace parsergen::nfa
+
+#endif
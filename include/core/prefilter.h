@@ -0,0 +1,53 @@
+#ifndef __PREFILTER_H
+#define __PREFILTER_H
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/common.h"
+#include "core/re.h"
+
+namespace parsergen {
+
+// Literals one of which every match of a regex contains, at most lead bytes
+// after the start of the match. Searching for them with memchr/memcmp or a
+// vector compare skips the bytes where no match can start without touching
+// the dfa.
+class Prefilter {
+ public:
+  static constexpr size_t MAX_LITERALS = 16;
+
+  Prefilter(std::vector<std::string> literals, size_t lead);
+
+  const std::vector<std::string>& literals() const { return lits; }
+  size_t lead() const { return lead_; }
+
+  // no match starting at pos or later starts before the returned position,
+  // npos when no match can start at all
+  size_t skip(std::string_view sv, size_t pos) const;
+  // the first occurrence of any literal at pos or later, or npos
+  size_t find(std::string_view sv, size_t pos) const;
+
+  // the literals with the longest shortest one, then the fewest, then the
+  // smallest lead. Nothing when some match needs no literal or the lead is
+  // unbounded.
+  static std::optional<Prefilter> from_re(const re::Re& re);
+  // every rule must have literals, they are united
+  static std::optional<Prefilter> from_re(
+      const std::vector<std::unique_ptr<re::Re>>& res);
+
+ private:
+  std::vector<std::string> lits;
+  size_t lead_;
+  // distinct first bytes of the literals
+  std::vector<u8> firsts;
+  std::array<bool, 256> is_first;
+};
+
+}  // namespace parsergen
+
+#endif
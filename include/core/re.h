@@ -2,6 +2,7 @@
 #define __CORE_H
 
 #include <memory>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
@@ -17,6 +18,7 @@ class Char;
 class Kleene;
 class Concat;
 class Disjunction;
+class Group;
 
 class Re {
  public:
@@ -26,6 +28,7 @@ class Re {
     kKleene,
     kConcat,
     kDisjunction,
+    kGroup,
   };
 
   ReKind kind;
@@ -34,9 +37,21 @@ class Re {
   virtual ~Re() {}
 
   static std::unique_ptr<Re> parse_without_pipe(std::string_view sv);
-  static std::unique_ptr<Re> parse_brackets(std::string_view sv);
-  static std::unordered_set<char> _expand_metachar(std::string_view sv);
+  // groups counts the groups parsed so far, across the alternatives of
+  // parse. These return nullptr, or an empty set, with the reason in error
+  // when sv is malformed.
+  static std::unique_ptr<Re> parse_without_pipe(std::string_view sv,
+                                                u32& groups,
+                                                std::string& error);
+  static std::unique_ptr<Re> parse_brackets(std::string_view sv,
+                                            std::string& error);
+  static std::unordered_set<char> _expand_metachar(std::string_view sv,
+                                                   std::string& error);
+  // exits the process when sv is malformed
   static std::unique_ptr<Re> parse(std::string_view sv);
+  // nullptr when sv is malformed, with the reason in error if given
+  static std::unique_ptr<Re> try_parse(std::string_view sv,
+                                       std::string* error = nullptr);
 };
 
 class Eps : public Re {
@@ -105,6 +120,24 @@ class Disjunction : public Re {
   virtual ~Disjunction() override {}
 };
 
+// a parenthesized subexpression, numbered from 1 in the order of its '('
+class Group : public Re {
+ public:
+  std::unique_ptr<Re> son;
+  u32 index;
+  explicit Group(std::unique_ptr<Re> son, u32 index)
+      : Re(ReKind::kGroup), son(std::move(son)), index(index) {}
+  static bool classof(const Re* base) { return base->kind == ReKind::kGroup; }
+
+  std::unique_ptr<Group> clone_impl() const {
+    return std::make_unique<Group>(son->clone(), index);
+  }
+  virtual ~Group() override {}
+};
+
+// the largest group index in re, 0 without groups
+u32 group_num(const Re& re);
+
 void dfs(std::unique_ptr<Re>& re,
          std::function<void(std::unique_ptr<re::Re>&)> fn);
 
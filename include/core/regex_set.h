@@ -0,0 +1,79 @@
+#ifndef __REGEX_SET_H
+#define __REGEX_SET_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "core/aho_corasick.h"
+#include "core/common.h"
+#include "core/dfa.h"
+#include "core/hybrid.h"
+#include "core/lazy_dfa.h"
+#include "core/nfa.h"
+#include "core/re.h"
+#include "core/table.h"
+
+namespace parsergen::dfa {
+
+// Many rules matched in one pass, reporting every rule that matches rather
+// than the lowest one. The rules are merged into one dfa whose accepting
+// states are labelled by the set of rules they accept for, with the same
+// budget and lazy fallback as Hybrid, so thousands of rules cost one walk
+// over the input instead of one per rule. Rules that are plain strings go
+// to an Aho-Corasick trie instead, keyword j labelled by the rules of j.
+class RegexSet {
+ public:
+  // the rules matching all of sv in ascending order, empty when none
+  const std::vector<u32>& matches(std::string_view sv) {
+    if (auto dfa = std::get_if<CompiledDfa>(&engine)) {
+      auto label = dfa->accept(sv);
+      return label ? sets[*label] : none;
+    }
+    if (auto literals = std::get_if<AhoCorasick>(&engine)) {
+      auto label = literals->accept(sv);
+      return label ? sets[*label] : none;
+    }
+    auto& lazy = std::get<LazyDfa>(engine);
+    auto label = lazy.accept(sv);
+    return label ? lazy.rules(*label) : none;
+  }
+  bool is_match(std::string_view sv) { return !matches(sv).empty(); }
+
+  // whether the full dfa fit
+  bool is_dfa() const { return std::holds_alternative<CompiledDfa>(engine); }
+  // whether the rules were all plain strings
+  bool is_literal() const {
+    return std::holds_alternative<AhoCorasick>(engine);
+  }
+  // the lazy dfa counts its sets of rules in its own memory
+  size_t memory() const {
+    return sets.memory() +
+           std::visit([](const auto& e) { return e.memory(); }, engine);
+  }
+
+  // rule i is svs[i], std::nullopt when one of them is not a valid pattern
+  static std::optional<RegexSet> from_sv(
+      const std::vector<std::string_view>& svs, Budget budget = {});
+  // rule i is res[i]
+  static RegexSet from_re(std::vector<std::unique_ptr<re::Re>>&& res,
+                          Budget budget = {});
+  // the rules are the terminal ids of nfa
+  static RegexSet from_nfa(nfa::Nfa&& nfa, Budget budget = {});
+
+ private:
+  using Engine = std::variant<CompiledDfa, LazyDfa, AhoCorasick>;
+  RegexSet(Engine&& engine, RuleSets&& sets)
+      : engine(std::move(engine)), sets(std::move(sets)) {}
+
+  Engine engine;
+  // the labels of the compiled dfa or the trie, the lazy dfa keeps its own
+  RuleSets sets;
+  std::vector<u32> none;
+};
+
+}  // namespace parsergen::dfa
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __SCANNER_H
+#define __SCANNER_H
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "core/common.h"
+#include "core/table.h"
+
+namespace parsergen::dfa {
+
+// Maximal munch over input that arrives in chunks. The dfa state and the
+// unfinished token are carried from one feed() to the next, a token is
+// emitted as soon as no longer match can follow, and only the bytes of a
+// token that straddles a chunk boundary are copied.
+class Scanner {
+ public:
+  // token.pos is the offset in the whole stream, text is only valid during
+  // the call
+  using Callback =
+      std::function<void(const Token& token, std::string_view text)>;
+
+  // dfa is kept by reference and must outlive the scanner
+  Scanner(const CompiledDfa& dfa, Callback callback);
+  Scanner(CompiledDfa&& dfa, Callback callback) = delete;
+
+  // false once some input can not be tokenized, pos() tells where
+  bool feed(std::string_view chunk);
+  // end of the stream, flushes the unfinished token
+  bool finish();
+
+  // stream offset of the first byte not covered by an emitted token
+  size_t pos() const { return token_pos; }
+
+ private:
+  template <typename Table>
+  bool run(const Table& table, bool eof);
+  u8 byte_at(size_t pos) const;
+  void emit();
+
+  const CompiledDfa& dfa;
+  Callback callback;
+  // terminal states without live edges end their token right away
+  std::vector<bool> dead_end;
+
+  // the stream bytes [token_pos, chunk_pos) of the unfinished token, from
+  // pending[pending_begin] on
+  std::string pending;
+  size_t pending_begin = 0;
+  std::string_view chunk;
+  size_t chunk_pos = 0;
+  size_t token_pos = 0;
+  // the next byte to feed into cur
+  size_t scan_pos = 0;
+  u32 cur;
+  // terminal id and length of the longest match of the unfinished token
+  std::optional<std::pair<u32, size_t>> last;
+  // the pairs passed after last as (state, first, last), see tokenize(),
+  // they fail once the token is emitted
+  std::vector<std::tuple<u32, size_t, size_t>> trail;
+  // keeps rescans linear, see tokenize()
+  FailedPairs failed_pairs;
+  bool failed = false;
+};
+
+}  // namespace parsergen::dfa
+
+#endif
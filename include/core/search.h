@@ -0,0 +1,89 @@
+#ifndef __SEARCH_H
+#define __SEARCH_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "core/aho_corasick.h"
+#include "core/common.h"
+#include "core/dfa.h"
+#include "core/nfa.h"
+#include "core/prefilter.h"
+#include "core/re.h"
+#include "core/table.h"
+
+namespace parsergen::dfa {
+
+// Unanchored search with leftmost-longest semantics. The implicit .* prefix
+// is compiled into a forward dfa whose states are the nfa state sets of all
+// the match attempts still alive, ordered by their start. One pass of it
+// finds where the leftmost-longest match ends, a reverse dfa of the same
+// nfa then runs backwards from there and its last terminal is the start.
+// Whenever no attempt is alive, a prefilter over the literals every match
+// needs jumps ahead to the next position where a match can start. A rule
+// set of plain strings skips all of this for an Aho-Corasick automaton.
+class Searcher {
+ public:
+  // the first leftmost-longest match starting at pos or later
+  std::optional<Match> find(std::string_view sv, size_t pos = 0) const;
+  // non overlapping matches from left to right, an empty match moves the
+  // search one byte forward
+  std::vector<Match> find_all(std::string_view sv) const;
+  // the number of matches find_all would return, without locating starts
+  size_t count(std::string_view sv) const;
+
+  // nothing when sv is not a valid pattern, the nfa has more than 1024 nodes
+  // or one of the dfas needs too many states
+  static std::optional<Searcher> from_sv(std::string_view sv, u32 id = 0);
+  static std::optional<Searcher> from_re(std::unique_ptr<re::Re> re,
+                                         u32 id = 0);
+  // rule i gets terminal id i, ties go to the lowest id. Rules that each
+  // match one fixed string never fail, whatever their number.
+  static std::optional<Searcher> from_re(
+      std::vector<std::unique_ptr<re::Re>>&& res);
+  // without a regex there is no prefilter
+  static std::optional<Searcher> from_nfa(
+      nfa::Nfa&& nfa, std::optional<Prefilter> prefilter = std::nullopt);
+
+  const std::optional<Prefilter>& prefilter() const { return filter; }
+  // whether the rules were all plain strings
+  bool is_literal() const {
+    return std::holds_alternative<AhoCorasick>(engine);
+  }
+
+  // the forward dfa above: node 0 is the state where only the attempt
+  // starting at the current byte is alive, a node is terminal when the
+  // leftmost attempt that ever matched is matching right now. Nothing when
+  // the nfa has more than 1024 nodes or the dfa more than 65536 states.
+  static std::optional<Dfa> unanchored_from_nfa(const nfa::Nfa& nfa);
+
+ private:
+  struct Dfas {
+    CompiledDfa forward;
+    // anchored at the match end, reads the haystack backwards
+    CompiledDfa reverse;
+  };
+  Searcher(Dfas&& dfas, std::optional<Prefilter> filter)
+      : engine(std::move(dfas)), filter(std::move(filter)) {}
+  explicit Searcher(AhoCorasick&& literals) : engine(std::move(literals)) {}
+
+  struct End {
+    u32 id;
+    // no match starts before restart
+    size_t restart;
+    size_t end;
+  };
+  std::optional<End> find_end(std::string_view sv, size_t pos) const;
+  // the smallest begin >= restart with sv[begin, end) matched
+  size_t find_begin(std::string_view sv, size_t restart, size_t end) const;
+
+  std::variant<Dfas, AhoCorasick> engine;
+  std::optional<Prefilter> filter;
+};
+
+}  // namespace parsergen::dfa
+
+#endif
@@ -0,0 +1,667 @@
+#ifndef __TABLE_H
+#define __TABLE_H
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "core/common.h"
+#include "core/dfa.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace parsergen::dfa {
+
+// A state that stays in itself for all but a few bytes. The run of bytes
+// that keep it there is skipped with a vector search for its end instead of
+// one transition per byte.
+struct Accel {
+  enum Kind : u8 {
+    kNone,
+    // the run ends at any of bytes[0..num), num <= 3
+    kEscape,
+    // the run goes on while bytes[0] <= c <= bytes[1]
+    kRange,
+  };
+  // a narrower range seldom makes runs that pay for entering run(), the
+  // digits of a number are the narrowest that still do
+  static constexpr u32 MIN_RANGE = 10;
+
+  Kind kind = kNone;
+  u8 num = 0;
+  u8 bytes[3] = {};
+
+  // the length of the run at the start of p[0..n)
+  size_t run(const char* p, size_t n) const {
+    size_t i = 0;
+    if (kind == kEscape) {
+      if (num == 0) return n;
+      if (num == 1) {
+        auto q = std::memchr(p, bytes[0], n);
+        return q ? (const char*)q - p : n;
+      }
+#ifdef __SSE2__
+      for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i hit = _mm_setzero_si128();
+        for (u32 k = 0; k < num; ++k) {
+          __m128i eq = _mm_cmpeq_epi8(block, _mm_set1_epi8(bytes[k]));
+          hit = _mm_or_si128(hit, eq);
+        }
+        if (u32 mask = _mm_movemask_epi8(hit)) return i + __builtin_ctz(mask);
+      }
+#endif
+      for (; i < n; ++i) {
+        for (u32 k = 0; k < num; ++k) {
+          if ((u8)p[i] == bytes[k]) return i;
+        }
+      }
+      return n;
+    }
+    u8 lo = bytes[0], width = bytes[1] - bytes[0];
+#ifdef __SSE2__
+    // unsigned c - lo <= width iff min(c - lo, width) == c - lo
+    for (; i + 16 <= n; i += 16) {
+      __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+      __m128i off = _mm_sub_epi8(block, _mm_set1_epi8(lo));
+      __m128i in = _mm_cmpeq_epi8(_mm_min_epu8(off, _mm_set1_epi8(width)), off);
+      if (u32 mask = ~_mm_movemask_epi8(in) & 0xffff) {
+        return i + __builtin_ctz(mask);
+      }
+    }
+#endif
+    for (; i < n; ++i) {
+      if ((u8)(p[i] - lo) > width) return i;
+    }
+    return n;
+  }
+};
+
+// Dfa flattened into one contiguous row-major transition table with one
+// column per byte class, rows are padded to a power of two columns.
+// Row 0 is the dead state whose transitions all loop back to itself, so the
+// matcher never has to test for a missing edge. Row 1 is the start state.
+// StateT is the narrowest unsigned type that can index every row.
+template <typename StateT>
+struct DenseTable {
+  using state_type = StateT;
+  static constexpr StateT DEAD_STATE = 0;
+  static constexpr StateT START_STATE = 1;
+
+  u32 stride_shift;
+  std::array<u8, 256> class_map;
+  // trans[(state << stride_shift) | class_map[byte]] is the next state
+  std::vector<StateT> trans;
+  std::vector<std::optional<u32>> terminals;
+  // indexed by state, empty unless some live state is accelerable
+  std::vector<Accel> accel;
+
+  u32 state_num() const { return (u32)terminals.size(); }
+  size_t memory() const {
+    return trans.size() * sizeof(StateT) +
+           terminals.size() * sizeof(std::optional<u32>) +
+           accel.size() * sizeof(Accel);
+  }
+
+  StateT next(StateT state, u8 c) const {
+    return trans[((u32)state << stride_shift) | class_map[c]];
+  }
+
+  // safe to call from many threads
+  std::optional<u32> accept(std::string_view sv) const {
+    const StateT* t = trans.data();
+    const u8* cls = class_map.data();
+    const u32 shift = stride_shift;
+    u32 cur = START_STATE;
+    if (accel.empty()) {
+      for (auto c : sv) cur = t[(cur << shift) | cls[(u8)c]];
+      return terminals[cur];
+    }
+    const char* p = sv.data();
+    for (size_t i = 0, n = sv.size(); i < n;) {
+      if (accel[cur].kind != Accel::kNone) {
+        i += accel[cur].run(p + i, n - i);
+        if (i == n) break;
+      }
+      cur = t[(cur << shift) | cls[(u8)p[i++]]];
+    }
+    return terminals[cur];
+  }
+
+  // dfa must have fewer than std::numeric_limits<StateT>::max() nodes.
+  // The other layouts build from a dense table without accel, they never
+  // use it.
+  static DenseTable from_dfa(const Dfa& dfa, bool accelerate = true);
+};
+
+// Tarjan-Yao comb vector: every row only keeps the entries that differ from
+// its default target, the rows are overlapped into one check/target vector
+// and identical rows share one placement. A slot belongs to a row iff its
+// check equals the base of that row. Same state numbering as DenseTable.
+struct CombTable {
+  static constexpr u32 DEAD_STATE = 0;
+  static constexpr u32 START_STATE = 1;
+  static constexpr u32 NO_OWNER = -1;
+
+  struct Row {
+    u32 base;
+    u32 deflt;
+  };
+
+  std::array<u8, 256> class_map;
+  // indexed by state
+  std::vector<Row> rows;
+  std::vector<u32> check;
+  std::vector<u32> target;
+  std::vector<std::optional<u32>> terminals;
+
+  u32 state_num() const { return (u32)terminals.size(); }
+  size_t memory() const {
+    return rows.size() * sizeof(Row) +
+           (check.size() + target.size()) * sizeof(u32) +
+           terminals.size() * sizeof(std::optional<u32>);
+  }
+
+  u32 next(u32 state, u8 c) const {
+    const Row& row = rows[state];
+    u32 i = row.base + class_map[c];
+    return check[i] == row.base ? target[i] : row.deflt;
+  }
+
+  std::optional<u32> accept(std::string_view sv) const {
+    u32 cur = START_STATE;
+    for (auto c : sv) cur = next(cur, c);
+    return terminals[cur];
+  }
+
+  static CombTable from_dfa(const Dfa& dfa);
+};
+
+// Every state is either a few sorted byte ranges [lo_i, lo_{i+1}) -> target
+// or a full row over the byte classes, whichever is smaller. The range of a
+// byte is found by comparing it against all lower bounds at once.
+struct SparseTable {
+  static constexpr u32 DEAD_STATE = 0;
+  static constexpr u32 START_STATE = 1;
+  static constexpr u32 MAX_RANGES = 16;
+
+  struct Entry {
+    u32 offset;
+    // 0 for a full row at dense[offset], otherwise the ranges are at
+    // lo[offset..offset + range_num) and range_target[...]
+    u32 range_num;
+  };
+
+  std::array<u8, 256> class_map;
+  // indexed by state
+  std::vector<Entry> entries;
+  std::vector<u32> dense;
+  // padded with MAX_RANGES bytes so a vector load never runs past the end
+  std::vector<u8> lo;
+  std::vector<u32> range_target;
+  std::vector<std::optional<u32>> terminals;
+
+  u32 state_num() const { return (u32)terminals.size(); }
+  size_t memory() const {
+    return entries.size() * sizeof(Entry) +
+           (dense.size() + range_target.size()) * sizeof(u32) + lo.size() +
+           terminals.size() * sizeof(std::optional<u32>);
+  }
+
+  // the number of lower bounds <= c among the first range_num ones
+  static u32 rank(const u8* lo, u32 range_num, u8 c) {
+#ifdef __SSE2__
+    __m128i bounds = _mm_loadu_si128((const __m128i*)lo);
+    __m128i cv = _mm_set1_epi8(c);
+    // unsigned lo <= c iff max(lo, c) == c
+    __m128i le = _mm_cmpeq_epi8(_mm_max_epu8(bounds, cv), cv);
+    u32 mask = (u32)_mm_movemask_epi8(le) & ((1u << range_num) - 1);
+    return __builtin_popcount(mask);
+#else
+    u32 r = 0;
+    for (u32 i = 0; i < range_num; ++i) r += lo[i] <= c;
+    return r;
+#endif
+  }
+
+  u32 next(u32 state, u8 c) const {
+    const Entry& e = entries[state];
+    if (e.range_num == 0) return dense[e.offset + class_map[c]];
+    // lo[offset] is always 0, so the rank is at least 1
+    return range_target[e.offset + rank(&lo[e.offset], e.range_num, c) - 1];
+  }
+
+  std::optional<u32> accept(std::string_view sv) const {
+    u32 cur = START_STATE;
+    for (auto c : sv) cur = next(cur, c);
+    return terminals[cur];
+  }
+
+  static SparseTable from_dfa(const Dfa& dfa);
+};
+
+// Two bytes per lookup on the state dependency chain: trans2 is indexed by
+// the state and the classes of a byte pair, the single byte rows of trans
+// handle an odd trailing byte. An entry of trans2 has MID_TERMINAL set when
+// the state between the two bytes is terminal, so a longest match ending
+// mid-pair is not lost. Meant for dfas with few byte classes, the pair rows
+// grow with the square of the class count.
+struct Stride2Table {
+  static constexpr u32 DEAD_STATE = 0;
+  static constexpr u32 START_STATE = 1;
+  static constexpr u32 MID_TERMINAL = 1u << 31;
+  static constexpr u32 STATE_MASK = MID_TERMINAL - 1;
+
+  u32 class_shift;
+  std::array<u8, 256> class_map;
+  // trans[(state << class_shift) | class_map[byte]]
+  std::vector<u32> trans;
+  // trans2[(state << 2 * class_shift) | pair(a, b)]
+  std::vector<u32> trans2;
+  std::vector<std::optional<u32>> terminals;
+
+  u32 state_num() const { return (u32)terminals.size(); }
+  size_t memory() const {
+    return (trans.size() + trans2.size()) * sizeof(u32) +
+           terminals.size() * sizeof(std::optional<u32>);
+  }
+
+  u32 next(u32 state, u8 c) const {
+    return trans[(state << class_shift) | class_map[c]];
+  }
+  u32 pair(u8 a, u8 b) const {
+    return ((u32)class_map[a] << class_shift) | class_map[b];
+  }
+  // the entry after a then b, with MID_TERMINAL
+  u32 next2(u32 state, u8 a, u8 b) const {
+    return trans2[(state << 2 * class_shift) | pair(a, b)];
+  }
+
+  std::optional<u32> accept(std::string_view sv) const {
+    const u32* t2 = trans2.data();
+    const u32 shift = 2 * class_shift;
+    const char* p = sv.data();
+    size_t n = sv.size();
+    u32 cur = START_STATE;
+    size_t i = 0;
+    // the pair classes do not depend on cur and are computed ahead
+    for (; i + 2 <= n; i += 2) {
+      cur = t2[(cur << shift) | pair(p[i], p[i + 1])] & STATE_MASK;
+    }
+    if (i < n) cur = next(cur, p[i]);
+    return terminals[cur];
+  }
+
+  static Stride2Table from_dfa(const Dfa& dfa);
+};
+
+// Data-parallel form of a dfa with at most 16 states: every byte class is a
+// 16 byte vector mapping each state to its successor, so a run of input is
+// the composition of those maps. Composing with pshufb needs no load that
+// depends on the state, and independent slices of the input are composed
+// side by side.
+struct ShuffleTable {
+  static constexpr u32 DEAD_STATE = 0;
+  static constexpr u32 START_STATE = 1;
+  static constexpr u32 MAX_STATES = 16;
+
+  std::array<u8, 256> class_map;
+  // perm[class][state] is the next state, unused states go to DEAD_STATE
+  std::vector<std::array<u8, MAX_STATES>> perm;
+  std::vector<std::optional<u32>> terminals;
+
+  u32 state_num() const { return (u32)terminals.size(); }
+  size_t memory() const {
+    return perm.size() * MAX_STATES +
+           terminals.size() * sizeof(std::optional<u32>);
+  }
+
+  u32 next(u32 state, u8 c) const { return perm[class_map[c]][state]; }
+
+  // the pshufb loop when the cpu has SSSE3
+  std::optional<u32> accept(std::string_view sv) const;
+
+  // dfa must have fewer than MAX_STATES nodes
+  static ShuffleTable from_dfa(const Dfa& dfa);
+};
+
+enum class Layout {
+  // one full row per state, narrowest state index
+  kDense,
+  // comb vector, for large and mostly sparse rule sets
+  kComb,
+  // byte ranges for the states where a full row wastes memory
+  kSparse,
+  // benchmark the accept() of every other layout and keep the fastest
+  kAuto,
+  // two bytes per lookup, only on request since it trades memory for a
+  // shorter dependency chain
+  kStride2,
+  // pshufb composition for dfas with at most 16 states, the others get
+  // kDense
+  kShuffle,
+};
+
+struct Token {
+  // the terminal id of the matched rule
+  u32 id;
+  size_t pos;
+  size_t len;
+};
+
+struct Match {
+  // the terminal id of the matched rule
+  u32 id;
+  // sv[begin, end) is the match
+  size_t begin;
+  size_t end;
+};
+
+// the number of bytes at the start of p[0..n) that keep state where it is,
+// 0 for layouts without accel
+template <typename Table>
+size_t accel_run(const Table&, u32, const char*, size_t) {
+  return 0;
+}
+template <typename StateT>
+size_t accel_run(const DenseTable<StateT>& table, u32 state, const char* p,
+                 size_t n) {
+  if (table.accel.empty() || table.accel[state].kind == Accel::kNone) return 0;
+  return table.accel[state].run(p, n);
+}
+
+// longest prefix of sv[pos..] that reaches a terminal state, ties are
+// already broken towards the lowest id by the subset construction
+template <typename Table>
+std::optional<Token> scan(const Table& table, std::string_view sv, size_t pos) {
+  std::optional<Token> token;
+  u32 cur = Table::START_STATE;
+  if (auto id = table.terminals[cur]) token = Token{*id, pos, 0};
+  for (size_t i = pos; i < sv.size(); ++i) {
+    if (size_t run = accel_run(table, cur, sv.data() + i, sv.size() - i)) {
+      i += run;
+      if (auto id = table.terminals[cur]) token = Token{*id, pos, i - pos};
+      if (i == sv.size()) break;
+    }
+    cur = table.next(cur, sv[i]);
+    if (cur == Table::DEAD_STATE) break;
+    if (auto id = table.terminals[cur]) token = Token{*id, pos, i + 1 - pos};
+  }
+  return token;
+}
+
+// same as above, two bytes at a time
+inline std::optional<Token> scan(const Stride2Table& table,
+                                 std::string_view sv, size_t pos) {
+  using Table = Stride2Table;
+  std::optional<Token> token;
+  u32 cur = Table::START_STATE;
+  if (auto id = table.terminals[cur]) token = Token{*id, pos, 0};
+  size_t i = pos;
+  for (; i + 2 <= sv.size(); i += 2) {
+    u32 entry = table.next2(cur, sv[i], sv[i + 1]);
+    if (entry & Table::MID_TERMINAL) {
+      u32 mid = table.next(cur, sv[i]);
+      token = Token{*table.terminals[mid], pos, i + 1 - pos};
+    }
+    cur = entry & Table::STATE_MASK;
+    if (cur == Table::DEAD_STATE) return token;
+    if (auto id = table.terminals[cur]) token = Token{*id, pos, i + 2 - pos};
+  }
+  if (i < sv.size()) {
+    cur = table.next(cur, sv[i]);
+    if (auto id = table.terminals[cur]) token = Token{*id, pos, i + 1 - pos};
+  }
+  return token;
+}
+
+// (state, pos) pairs from which no terminal state can be reached before
+// the dead state, only positions after the current token start are kept
+class FailedPairs {
+ public:
+  explicit FailedPairs(u32 state_num) : words((state_num + 63) / 64) {}
+
+  bool empty() const { return bits.empty(); }
+
+  bool test(u32 state, size_t pos) const {
+    size_t i = (pos - base) * words + state / 64;
+    return i < bits.size() && (bits[i] >> (state % 64) & 1);
+  }
+
+  void set(u32 state, size_t pos) {
+    size_t i = (pos - base) * words + state / 64;
+    if (bits.size() <= i) bits.resize((pos - base + 1) * words, 0);
+    bits[i] |= (u64)1 << (state % 64);
+  }
+
+  // (state, first), (state, first + 1), ..., (state, last)
+  void set(u32 state, size_t first, size_t last) {
+    for (size_t pos = first; pos <= last; ++pos) set(state, pos);
+  }
+
+  // positions before pos are never asked again
+  void advance(size_t pos) {
+    size_t drop = std::min((pos - base) * words, bits.size());
+    bits.erase(bits.begin(), bits.begin() + drop);
+    base = pos;
+  }
+
+ private:
+  size_t words;
+  size_t base = 0;
+  std::deque<u64> bits;
+};
+
+// maximal munch in linear time, Reps, "Maximal-munch tokenization in linear
+// time", TOPLAS 1998: every pair passed after the last terminal of a scan is
+// remembered as failed and cuts later scans short, so each (state, pos) pair
+// is visited at most once beyond its first terminal and the total work is
+// O(state_num * sv.size()) instead of quadratic. Only tokens starting
+// before limit are taken, the last one may run past it. failed can be kept
+// across calls that carry on from where the previous one stopped, the
+// bound then holds for all of them together. A run skipped by accel is
+// kept as a range and fails as a whole, so a rescan that enters it stops
+// right away instead of searching it again.
+template <typename Table>
+size_t tokenize(const Table& table, std::string_view sv, size_t pos,
+                size_t limit, std::vector<Token>& tokens,
+                FailedPairs& failed) {
+  failed.advance(pos);
+  // (state, first, last) stands for the pairs (state, first..last)
+  std::vector<std::tuple<u32, size_t, size_t>> trail;
+  while (pos < limit) {
+    std::optional<Token> token;
+    u32 cur = Table::START_STATE;
+    trail.clear();
+    for (size_t i = pos; i < sv.size(); ++i) {
+      if (size_t run = accel_run(table, cur, sv.data() + i, sv.size() - i)) {
+        size_t first = i;
+        i += run;
+        if (!failed.empty() && failed.test(cur, i)) break;
+        if (auto id = table.terminals[cur]) {
+          token = Token{*id, pos, i - pos};
+          trail.clear();
+        } else {
+          trail.emplace_back(cur, first, i);
+        }
+        if (i == sv.size()) break;
+      }
+      cur = table.next(cur, sv[i]);
+      if (cur == Table::DEAD_STATE) break;
+      if (!failed.empty() && failed.test(cur, i + 1)) break;
+      if (auto id = table.terminals[cur]) {
+        token = Token{*id, pos, i + 1 - pos};
+        trail.clear();
+      } else {
+        trail.emplace_back(cur, i + 1, i + 1);
+      }
+    }
+    if (!token) break;
+    tokens.push_back(*token);
+    pos += token->len;
+    failed.advance(pos);
+    for (auto [state, first, last] : trail) failed.set(state, first, last);
+  }
+  return pos;
+}
+
+template <typename Table>
+size_t tokenize(const Table& table, std::string_view sv, size_t pos,
+                size_t limit, std::vector<Token>& tokens) {
+  FailedPairs failed(table.state_num());
+  return tokenize(table, sv, pos, limit, tokens, failed);
+}
+
+template <typename Table>
+size_t tokenize(const Table& table, std::string_view sv,
+                std::vector<Token>& tokens) {
+  return tokenize(table, sv, 0, sv.size(), tokens);
+}
+
+// hint for the row a state is going to read, only where the row is one
+// contiguous block
+template <typename Table>
+void prefetch_row(const Table&, u32) {}
+template <typename StateT>
+void prefetch_row(const DenseTable<StateT>& table, u32 state) {
+  __builtin_prefetch(&table.trans[(size_t)state << table.stride_shift]);
+}
+
+// accept() over many inputs: LANES walks advance in lockstep, their chains
+// of dependent loads are independent so the cache misses of one lane
+// overlap the others. All lanes take as many steps as the shortest one has
+// left without any check, then the finished lanes take the next inputs.
+template <typename Table>
+void accept_batch(const Table& table, const std::string_view* inputs,
+                  std::optional<u32>* out, size_t n) {
+  constexpr u32 LANES = 8;
+  const char* p[LANES];
+  size_t left[LANES];
+  u32 cur[LANES];
+  size_t idx[LANES];
+  u32 active = 0;
+  size_t next_input = 0;
+  while (true) {
+    // retire finished lanes, the dead state never leaves so its input is
+    // done as well
+    for (u32 l = 0; l < active;) {
+      if (left[l] > 0 && cur[l] != Table::DEAD_STATE) {
+        ++l;
+        continue;
+      }
+      out[idx[l]] = table.terminals[cur[l]];
+      --active;
+      p[l] = p[active];
+      left[l] = left[active];
+      cur[l] = cur[active];
+      idx[l] = idx[active];
+    }
+    while (active < LANES && next_input < n) {
+      p[active] = inputs[next_input].data();
+      left[active] = inputs[next_input].size();
+      cur[active] = Table::START_STATE;
+      idx[active++] = next_input++;
+    }
+    if (active == 0) break;
+
+    size_t steps = left[0];
+    for (u32 l = 1; l < active; ++l) steps = std::min(steps, left[l]);
+    if (active == LANES) {
+      // the common case, a fixed trip count the compiler unrolls
+      for (size_t i = 0; i < steps; ++i) {
+        for (u32 l = 0; l < LANES; ++l) {
+          cur[l] = table.next(cur[l], p[l][i]);
+          prefetch_row(table, cur[l]);
+        }
+      }
+    } else {
+      for (size_t i = 0; i < steps; ++i) {
+        for (u32 l = 0; l < active; ++l) cur[l] = table.next(cur[l], p[l][i]);
+      }
+    }
+    for (u32 l = 0; l < active; ++l) {
+      p[l] += steps;
+      left[l] -= steps;
+    }
+  }
+}
+
+// accept_batch() with eight states in one AVX2 register, every step is a
+// single gather from the dense rows. Returns false and writes nothing when
+// the cpu has no AVX2.
+template <typename StateT>
+bool accept_batch_gather(const DenseTable<StateT>& table,
+                         const std::string_view* inputs,
+                         std::optional<u32>* out, size_t n);
+
+// The compiled form of a Dfa, all layouts behind one matcher API
+struct CompiledDfa {
+  using Table =
+      std::variant<DenseTable<u8>, DenseTable<u16>, DenseTable<u32>,
+                   CombTable, SparseTable, Stride2Table, ShuffleTable>;
+  Table table;
+
+  explicit CompiledDfa(Table&& table) : table(std::move(table)) {}
+
+  u32 state_num() const {
+    return std::visit([](const auto& t) { return t.state_num(); }, table);
+  }
+
+  size_t memory() const {
+    return std::visit([](const auto& t) { return t.memory(); }, table);
+  }
+
+  std::optional<u32> accept(std::string_view sv) const {
+    return std::visit([sv](const auto& t) { return t.accept(sv); }, table);
+  }
+
+  std::optional<Token> scan(std::string_view sv, size_t pos = 0) const {
+    return std::visit(
+        [sv, pos](const auto& t) { return dfa::scan(t, sv, pos); }, table);
+  }
+
+  // out[i] = accept(inputs[i]) for i < n, the walks are interleaved and
+  // dense tables use AVX2 gathers when the cpu has them
+  void accept_batch(const std::string_view* inputs, std::optional<u32>* out,
+                    size_t n) const {
+    std::visit(
+        [&](const auto& t) {
+          using T = std::decay_t<decltype(t)>;
+          if constexpr (std::is_same_v<T, DenseTable<u8>> ||
+                        std::is_same_v<T, DenseTable<u16>> ||
+                        std::is_same_v<T, DenseTable<u32>>) {
+            if (accept_batch_gather(t, inputs, out, n)) return;
+          }
+          dfa::accept_batch(t, inputs, out, n);
+        },
+        table);
+  }
+
+  // maximal munch in O(sv.size()): appends the tokens of sv to tokens, stops
+  // before the first byte that starts no non-empty token and returns its
+  // position
+  size_t tokenize(std::string_view sv, std::vector<Token>& tokens) const {
+    return std::visit(
+        [&](const auto& t) { return dfa::tokenize(t, sv, tokens); }, table);
+  }
+
+  // kDense picks the narrowest state index that fits the dfa.
+  // kAuto times accept() of every layout but kStride2 on sample cut where
+  // the dfa dies, or on a random walk over the dfa when sample is empty,
+  // and keeps the fastest one.
+  static CompiledDfa from_dfa(const Dfa& dfa, Layout layout = Layout::kDense,
+                              std::string_view sample = {});
+};
+
+}  // namespace parsergen::dfa
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef __TDFA_H
+#define __TDFA_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "core/byte_class.h"
+#include "core/common.h"
+#include "core/dfa.h"
+#include "core/nfa.h"
+#include "core/re.h"
+
+namespace parsergen::dfa {
+
+// where a capture group matched, both npos when it took no part
+struct Span {
+  size_t begin;
+  size_t end;
+};
+
+// A dfa that also extracts capture groups in its single pass. A state is
+// the ordered list of nfa states the subset construction would merge, the
+// order being the priority of their paths: the first path to reach an nfa
+// state wins, with the greedy branch of * and ? and the left one of | tried
+// first. Every item of a state owns one register per group boundary and each
+// transition carries the register operations that turn the registers of the
+// old items into those of the new ones, either a copy or the current
+// position when the path crossed a group boundary.
+class TaggedDfa {
+ public:
+  static constexpr u32 DEAD_STATE = 0;
+  static constexpr u32 START_STATE = 1;
+
+  // the rule matching all of sv, spans[0] is sv itself and spans[k] group k
+  // of the highest priority match
+  std::optional<u32> match(std::string_view sv, std::vector<Span>& spans) const;
+  // the same with the registers in regs, which only grows: a caller that
+  // keeps it across calls allocates nothing per match
+  std::optional<u32> match(std::string_view sv, std::vector<Span>& spans,
+                           std::vector<size_t>& regs) const;
+
+  u32 group_num() const { return tags / 2; }
+  u32 state_num() const { return (u32)terminals.size(); }
+  size_t memory() const {
+    return trans.size() * sizeof(u32) + op_begin.size() * sizeof(u32) +
+           (ops.size() + start_ops.size()) * sizeof(Op) +
+           terminals.size() * (sizeof(std::optional<u32>) + sizeof(u32));
+  }
+
+  // nothing when it needs more than max_states states
+  static std::optional<TaggedDfa> from_nfa(const nfa::Nfa& nfa, u32 groups,
+                                           u32 max_states = Dfa::MAX_STATES);
+  static std::optional<TaggedDfa> from_sv(std::string_view sv, u32 id = 0);
+  static std::optional<TaggedDfa> from_re(std::unique_ptr<re::Re> re,
+                                          u32 id = 0);
+  // groups are numbered per rule, rule i gets terminal id i
+  static std::optional<TaggedDfa> from_re(
+      std::vector<std::unique_ptr<re::Re>>&& res);
+
+ private:
+  // the register of the item sources are read from at the current position
+  static constexpr u32 POS = -1;
+  // no value yet
+  static constexpr u32 UNSET = -2;
+  struct Op {
+    u32 dst;
+    u32 src;
+  };
+
+  TaggedDfa(u32 tags, ByteClasses classes)
+      : tags(tags), classes(std::move(classes)) {}
+
+  // registers per item, the boundaries of groups 1 and up
+  u32 tags;
+  ByteClasses classes;
+  // row major, classes.num entries per state
+  std::vector<u32> trans;
+  // the ops of entry i of trans are ops[op_begin[i], op_begin[i + 1])
+  std::vector<u32> op_begin;
+  std::vector<Op> ops;
+  std::vector<Op> start_ops;
+  std::vector<std::optional<u32>> terminals;
+  // the first register of the item the match is read from
+  std::vector<u32> final_base;
+  // tags registers per nfa state, plus one to break cycles of copies
+  u32 reg_num = 0;
+};
+
+}  // namespace parsergen::dfa
+
+#endif
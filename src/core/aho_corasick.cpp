@@ -0,0 +1,254 @@
+#include "core/aho_corasick.h"
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <tuple>
+
+namespace parsergen::dfa {
+
+std::optional<u32> AhoCorasick::accept(std::string_view sv) const {
+  u32 state = ROOT;
+  for (auto c : sv) {
+    state = child(state, c);
+    if (state == NONE) return std::nullopt;
+  }
+  if (output[state] == NONE) return std::nullopt;
+  return output[state];
+}
+
+void AhoCorasick::for_each_match(
+    std::string_view sv, const std::function<void(const Match&)>& fn) const {
+  auto report = [&](u32 state, size_t end) {
+    for (u32 u = output[state] != NONE ? state : out_link[state]; u != NONE;
+         u = out_link[u]) {
+      fn(Match{output[u], end - depth[u], end});
+    }
+  };
+  u32 state = ROOT;
+  report(state, 0);
+  for (size_t i = 0; i < sv.size(); ++i) {
+    state = next(state, sv[i]);
+    report(state, i + 1);
+  }
+}
+
+std::optional<Match> AhoCorasick::find(std::string_view sv, size_t pos) const {
+  std::optional<Match> best;
+  auto consider = [&](u32 state, size_t end) {
+    for (u32 u = output[state] != NONE ? state : out_link[state]; u != NONE;
+         u = out_link[u]) {
+      Match m{output[u], end - depth[u], end};
+      if (!best || m.begin < best->begin ||
+          (m.begin == best->begin && m.end > best->end)) {
+        best = m;
+      }
+    }
+  };
+  u32 state = ROOT;
+  consider(state, pos);
+  for (size_t i = pos; i < sv.size(); ++i) {
+    // every later match starts at i - depth[state] or after
+    if (best && i - depth[state] > best->begin) break;
+    state = next(state, sv[i]);
+    consider(state, i + 1);
+  }
+  return best;
+}
+
+std::vector<Match> AhoCorasick::find_all(std::string_view sv) const {
+  std::vector<Match> matches;
+  size_t pos = 0;
+  while (pos <= sv.size()) {
+    auto match = find(sv, pos);
+    if (!match) break;
+    matches.push_back(*match);
+    pos = match->end > match->begin ? match->end : match->end + 1;
+  }
+  return matches;
+}
+
+AhoCorasick AhoCorasick::from_literals(
+    const std::vector<std::string_view>& words) {
+  AhoCorasick ac;
+  // sorted keywords put every trie node's subtree into one range, and a
+  // keyword before its extensions
+  std::vector<u32> order(words.size());
+  for (u32 i = 0; i < (u32)order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&words](u32 a, u32 b) {
+    return std::tie(words[a], a) < std::tie(words[b], b);
+  });
+  auto word = [&](u32 i) { return words[order[i]]; };
+
+  // free slots form a doubly linked list, new slots are appended
+  std::vector<u32> free_next, free_prev;
+  u32 free_head = NONE, free_tail = NONE;
+  auto grow = [&](size_t size) {
+    for (u32 i = ac.check.size(); i < size; ++i) {
+      ac.base.push_back(0);
+      ac.check.push_back(NONE);
+      ac.fail.push_back(ROOT);
+      ac.out_link.push_back(NONE);
+      ac.depth.push_back(0);
+      ac.output.push_back(NONE);
+      free_next.push_back(NONE);
+      free_prev.push_back(free_tail);
+      if (free_tail == NONE) {
+        free_head = i;
+      } else {
+        free_next[free_tail] = i;
+      }
+      free_tail = i;
+    }
+  };
+  // the free slot first fit starts from, the ones before it are left as
+  // they are once they proved too crowded: NONE for the head of the list
+  u32 from = NONE;
+  auto take = [&](u32 i) {
+    if (i == from) {
+      // from never falls back to the head, more slots keep it past i
+      if (free_next[i] == NONE) grow(ac.check.size() + 256);
+      from = free_next[i];
+    }
+    (free_prev[i] == NONE ? free_head : free_next[free_prev[i]]) = free_next[i];
+    (free_next[i] == NONE ? free_tail : free_prev[free_next[i]]) = free_prev[i];
+  };
+  // first fit, bases start at 1 so no child ever lands on the root. A
+  // search that skips many free slots moves from past them, so that a
+  // crowded prefix is not scanned again by every later state.
+  constexpr u32 MAX_SKIPPED = 64;
+  auto find_base = [&](const std::vector<u8>& bytes) {
+    u32 last = NONE;
+    u32 skipped = 0;
+    for (u32 p = from == NONE ? free_head : from;;
+         last = p, p = free_next[p], ++skipped) {
+      if (p == NONE) {
+        grow(ac.check.size() + 256);
+        p = last == NONE ? free_head : free_next[last];
+      }
+      if (p <= bytes[0]) continue;
+      u32 b = p - bytes[0];
+      if (ac.check.size() < b + 256) grow(b + 256);
+      bool fits = true;
+      for (auto c : bytes) fits &= ac.check[b + c] == NONE;
+      if (!fits) continue;
+      if (skipped > MAX_SKIPPED) from = p;
+      return b;
+    }
+  };
+
+  grow(256);
+  take(ROOT);
+  ac.check[ROOT] = ROOT;
+  ac.state_count = 1;
+  // (state, range of keywords below it)
+  std::deque<std::tuple<u32, u32, u32>> queue;
+  u32 lo = 0;
+  while (lo < order.size() && word(lo).empty()) {
+    if (ac.output[ROOT] == NONE) ac.output[ROOT] = order[lo];
+    ++lo;
+  }
+  queue.emplace_back(ROOT, lo, (u32)order.size());
+  std::vector<u8> bytes;
+  std::vector<std::pair<u32, u32>> ranges;
+  while (!queue.empty()) {
+    auto [state, lo, hi] = queue.front();
+    queue.pop_front();
+    if (lo == hi) continue;
+    u32 d = ac.depth[state];
+    bytes.clear();
+    ranges.clear();
+    for (u32 i = lo; i < hi;) {
+      u8 c = word(i)[d];
+      u32 j = i;
+      while (j < hi && (u8)word(j)[d] == c) ++j;
+      bytes.push_back(c);
+      ranges.emplace_back(i, j);
+      i = j;
+    }
+    u32 b = find_base(bytes);
+    ac.base[state] = b;
+    for (u32 k = 0; k < (u32)bytes.size(); ++k) {
+      u8 c = bytes[k];
+      u32 t = b + c;
+      take(t);
+      ++ac.state_count;
+      ac.check[t] = state;
+      ac.depth[t] = d + 1;
+      // states of depth <= d and their children already exist
+      u32 f = ROOT;
+      for (u32 s = state; s != ROOT;) {
+        s = ac.fail[s];
+        if (u32 u = ac.child(s, c); u != NONE) {
+          f = u;
+          break;
+        }
+      }
+      ac.fail[t] = f;
+      ac.out_link[t] = ac.output[f] != NONE ? f : ac.out_link[f];
+      // the keyword equal to this prefix comes first in the range
+      auto [i, j] = ranges[k];
+      while (i < j && word(i).size() == d + 1) {
+        if (ac.output[t] == NONE) ac.output[t] = order[i];
+        ++i;
+      }
+      queue.emplace_back(t, i, j);
+    }
+  }
+
+  // trailing free slots are never reached, child() checks the bound
+  size_t size = ac.check.size();
+  while (size > 0 && ac.check[size - 1] == NONE) --size;
+  for (auto v : {&ac.base, &ac.check, &ac.fail, &ac.out_link, &ac.depth,
+                 &ac.output}) {
+    v->resize(size);
+    v->shrink_to_fit();
+  }
+  return ac;
+}
+
+// appends the only string re matches, false if there are several
+static bool literal_of(const re::Re* re, std::string& out) {
+  switch (re->kind) {
+    case re::Re::kEps:
+      return true;
+    case re::Re::kChar:
+      out.push_back(static_cast<const re::Char*>(re)->c);
+      return true;
+    case re::Re::kKleene:
+      return false;
+    case re::Re::kConcat: {
+      for (auto& son : static_cast<const re::Concat*>(re)->sons) {
+        if (!literal_of(son.get(), out)) return false;
+      }
+      return true;
+    }
+    case re::Re::kDisjunction: {
+      auto dis = static_cast<const re::Disjunction*>(re);
+      return dis->sons.size() == 1 && literal_of(dis->sons[0].get(), out);
+    }
+    case re::Re::kGroup:
+      return literal_of(static_cast<const re::Group*>(re)->son.get(), out);
+    default:
+      UNREACHABLE();
+  }
+}
+
+std::optional<std::vector<std::string>> AhoCorasick::literals_of(
+    const std::vector<std::unique_ptr<re::Re>>& res) {
+  std::vector<std::string> literals(res.size());
+  for (size_t i = 0; i < res.size(); ++i) {
+    if (!literal_of(res[i].get(), literals[i])) return std::nullopt;
+  }
+  return literals;
+}
+
+std::optional<AhoCorasick> AhoCorasick::from_re(
+    const std::vector<std::unique_ptr<re::Re>>& res) {
+  auto literals = literals_of(res);
+  if (!literals) return std::nullopt;
+  return from_literals(
+      std::vector<std::string_view>(literals->begin(), literals->end()));
+}
+
+}  // namespace parsergen::dfa
@@ -0,0 +1,90 @@
+#include "core/byte_class.h"
+
+namespace parsergen {
+
+void ByteClasses::refine(const std::array<u32, 256>& key) {
+  std::unordered_map<u64, u32> new_class;
+  for (int b = 0; b < 256; ++b) {
+    u64 k = ((u64)map[b] << 32) | key[b];
+    auto it = new_class.find(k);
+    if (it == new_class.end()) {
+      it = new_class.emplace(k, (u32)new_class.size()).first;
+    }
+    map[b] = it->second;
+  }
+  num = new_class.size();
+  assert(num >= 1 && num <= 256);
+}
+
+void ByteClasses::refine(const ByteClasses& other) {
+  std::array<u32, 256> key;
+  for (int b = 0; b < 256; ++b) key[b] = other.map[b];
+  refine(key);
+}
+
+std::vector<u8> ByteClasses::representatives() const {
+  std::vector<u8> reps(num);
+  for (int b = 255; b >= 0; --b) reps[map[b]] = b;
+  return reps;
+}
+
+std::vector<std::vector<u8>> ByteClasses::members() const {
+  std::vector<std::vector<u8>> ret(num);
+  for (int b = 0; b < 256; ++b) ret[map[b]].push_back(b);
+  return ret;
+}
+
+static void from_re_impl(const re::Re* re, ByteClasses& classes) {
+  std::array<u32, 256> key;
+  switch (re->kind) {
+    case re::Re::kEps:
+      break;
+    case re::Re::kChar: {
+      key.fill(0);
+      key[(u8) static_cast<const re::Char*>(re)->c] = 1;
+      classes.refine(key);
+      break;
+    }
+    case re::Re::kKleene: {
+      from_re_impl(static_cast<const re::Kleene*>(re)->son.get(), classes);
+      break;
+    }
+    case re::Re::kConcat: {
+      for (auto& son : static_cast<const re::Concat*>(re)->sons) {
+        from_re_impl(son.get(), classes);
+      }
+      break;
+    }
+    case re::Re::kDisjunction: {
+      auto dis = static_cast<const re::Disjunction*>(re);
+      bool char_set = !dis->sons.empty();
+      for (auto& son : dis->sons) char_set &= isa<re::Char>(son);
+      if (!char_set) {
+        for (auto& son : dis->sons) from_re_impl(son.get(), classes);
+        break;
+      }
+      // a char set is compiled into one node with an edge per byte to the
+      // same exit, so its bytes behave the same in every nfa state
+      key.fill(0);
+      for (auto& son : dis->sons) {
+        key[(u8) static_cast<const re::Char*>(son.get())->c] = 1;
+      }
+      classes.refine(key);
+      break;
+    }
+    case re::Re::kGroup: {
+      from_re_impl(static_cast<const re::Group*>(re)->son.get(), classes);
+      break;
+    }
+    default:
+      UNREACHABLE();
+  }
+}
+
+ByteClasses ByteClasses::from_re(const re::Re& re) {
+  ByteClasses classes;
+  from_re_impl(&re, classes);
+  return classes;
+}
+
+}  // namespace parsergen
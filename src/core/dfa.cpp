@@ -1,5 +1,7 @@
 #include "core/dfa.h"
 
+#include <algorithm>
+
 namespace parsergen::dfa {
 
 void dfs_impl(u32 state_idx, Dfa& dfa, std::vector<bool>& visit,
@@ -21,6 +23,18 @@ void dfs(Dfa& dfa, std::function<void(u32, DfaNode&)> fn) {
   dfs_impl(0, dfa, visit, fn);
 }
 
+ByteClasses Dfa::byte_classes(const std::vector<DfaNode>& nodes) {
+  ByteClasses classes;
+  std::array<u32, 256> key;
+  for (auto& [_, next] : nodes) {
+    // missing edges lead to the dead state
+    key.fill(0);
+    for (auto [c, next_idx] : next) key[c] = next_idx + 1;
+    classes.refine(key);
+  }
+  return classes;
+}
+
 void bfs(Dfa& dfa, std::function<void(u32, DfaNode&)> fn) {
   std::vector<bool> visit(dfa.nodes.size(), false);
   std::vector<u32> stack;
@@ -49,6 +63,9 @@ static void minimize_impl(Dfa& dfa) {
   // the extra is the dead state
   using bitset = std::bitset<DFA_STATE_NUM + 1>;
   std::unordered_set<bitset> partition;
+  // bytes of one class always move together
+  auto reps = dfa.classes.representatives();
+  auto members = dfa.classes.members();
 
   // init partition
   constexpr u32 DEAD_STATE_IDX = DFA_STATE_NUM;
@@ -81,7 +98,7 @@ static void minimize_impl(Dfa& dfa) {
       }
 
       // try partition
-      for (int a = 0; a < 256; ++a) {
+      for (auto a : reps) {
         std::unordered_map<u32, std::unordered_set<u32>> map;
         std::unordered_set<u32> dst_set;
         bitset dst_bs;
@@ -144,6 +161,7 @@ static void minimize_impl(Dfa& dfa) {
       }
     }
   }
+  u32 dead_group_idx = state_to_group_idx[DEAD_STATE_IDX];
   std::vector<std::unordered_map<u8, u32>> next_vec(final_partition.size());
   std::vector<std::optional<u32>> terminal_vec(final_partition.size());
   // start node is always 0
@@ -169,7 +187,8 @@ static void minimize_impl(Dfa& dfa) {
             assert(!terminal_vec[group_idx]);
           }
         }
-        for (int a = 0; a < 256; ++a) {
+        for (u32 k = 0; k < (u32)reps.size(); ++k) {
+          auto a = reps[k];
           u32 dst_idx;
           if (state_idx == DEAD_STATE_IDX)
             dst_idx = DEAD_STATE_IDX;
@@ -183,11 +202,13 @@ static void minimize_impl(Dfa& dfa) {
           }
 
           auto dst_group_idx = state_to_group_idx[dst_idx];
+          // a missing edge already means the dead state
+          if (dst_group_idx == dead_group_idx) continue;
           // group_idx ----- a ----> dst_group_idx
           if (next_vec[group_idx].find(a) != next_vec[group_idx].end()) {
             assert(next_vec[group_idx][a] == dst_group_idx);
           }
-          next_vec[group_idx][a] = dst_group_idx;
+          for (auto b : members[k]) next_vec[group_idx][b] = dst_group_idx;
         }
 
         // only do it once
@@ -238,11 +259,12 @@ void Dfa::minimize() {
   // to make sure no dead state
   this->remove_dead_state();
   // TODO: more efficiency
-#define CHECK_SIZE_BEFORE_WORK(N) \
-  if (this->nodes.size() <= N) {  \
-    minimize_impl<N>(*this);      \
-    this->remove_dead_state();    \
-    return;                       \
+#define CHECK_SIZE_BEFORE_WORK(N)        \
+  if (this->nodes.size() <= N) {         \
+    minimize_impl<N>(*this);             \
+    this->remove_dead_state();           \
+    this->classes = byte_classes(nodes); \
+    return;                              \
   }
 
   CHECK_SIZE_BEFORE_WORK(15);
@@ -263,21 +285,41 @@ void Dfa::remove_dead_state() {
   // TODO: more efficient
   std::unordered_map<u32, u32> reindex;
 
-  std::vector<bool> terminable(this->nodes.size(), false);
-  std::unordered_set<u32> alive_idx;
+  // a state is alive when it is reachable and reaches a terminal. A post
+  // order dfs alone misses states whose only way out is a back edge to a
+  // state still on the dfs stack, so walk the reversed edges instead.
+  std::vector<std::vector<u32>> preds(this->nodes.size());
+  std::vector<bool> reachable(this->nodes.size(), false);
   dfs(*this, [&](u32 state_idx, DfaNode& node) {
-    auto& [terminal, next] = node;
-    if (terminal)
-      terminable[state_idx] = true;
-    else {
-      for (auto [c, next_idx] : next) {
-        terminable[state_idx] = terminable[state_idx] | terminable[next_idx];
-      }
-    }
-    if (terminable[state_idx]) {
-      alive_idx.insert(state_idx);
+    reachable[state_idx] = true;
+    for (auto [c, next_idx] : std::get<1>(node)) {
+      preds[next_idx].push_back(state_idx);
     }
   });
+  std::vector<bool> terminable(this->nodes.size(), false);
+  std::vector<u32> stack;
+  for (u32 i = 0; i < (u32)this->nodes.size(); ++i) {
+    if (reachable[i] && std::get<0>(this->nodes[i])) {
+      terminable[i] = true;
+      stack.push_back(i);
+    }
+  }
+  while (!stack.empty()) {
+    u32 t = stack.back();
+    stack.pop_back();
+    for (auto p : preds[t]) {
+      if (!terminable[p]) {
+        terminable[p] = true;
+        stack.push_back(p);
+      }
+    }
+  }
+  // the start state stays even when nothing is accepted
+  if (!terminable.empty()) terminable[0] = true;
+  std::unordered_set<u32> alive_idx;
+  for (u32 i = 0; i < (u32)this->nodes.size(); ++i) {
+    if (terminable[i]) alive_idx.insert(i);
+  }
   int alive_num = 0;
   bfs(*this, [&](u32 state_idx, DfaNode& node) {
     if (terminable[state_idx]) reindex[state_idx] = alive_num++;
@@ -313,10 +355,19 @@ Dfa Dfa::from_sv(std::string_view sv, u32 id) {
   return from_re(std::move(re), id);
 }
 
+u32 RuleSets::intern(std::vector<u32>&& ids) {
+  auto it = labels.find(ids);
+  if (it != labels.end()) return it->second;
+  ids_num += ids.size();
+  sets.push_back(ids);
+  return labels.emplace(std::move(ids), size() - 1).first->second;
+}
+
 // "Compilers: Principles, Techniques and Tools" Algorithm 3.20
 // subset construction
 template <int NFA_STATE_NUM>
-static Dfa from_nfa_impl(nfa::Nfa&& nfa) {
+static std::optional<Dfa> from_nfa_impl(const nfa::Nfa& nfa, u32 max_states,
+                                        RuleSets* sets) {
   using bitset = std::bitset<NFA_STATE_NUM>;
   auto e_closure = [&nfa](const bitset& T) {
     bitset bs = T;
@@ -338,7 +389,7 @@ static Dfa from_nfa_impl(nfa::Nfa&& nfa) {
     return bs;
   };
 
-  auto move = [&nfa](const bitset& T, char c) {
+  auto move = [&nfa](const bitset& T, u8 c) {
     bitset bs;
     for (int idx = 0; idx < NFA_STATE_NUM; ++idx) {
       if (T[idx]) {
@@ -353,8 +404,20 @@ static Dfa from_nfa_impl(nfa::Nfa&& nfa) {
     return bs;
   };
 
-  auto is_terminal = [&nfa](const bitset& T) {
+  auto is_terminal = [&nfa, sets](const bitset& T) {
     std::optional<u32> terminal;
+    if (sets) {
+      std::vector<u32> ids;
+      for (int idx = 0; idx < NFA_STATE_NUM; ++idx) {
+        if (T[idx] && nfa.nodes[idx].terminal_id) {
+          ids.push_back(*nfa.nodes[idx].terminal_id);
+        }
+      }
+      std::sort(ids.begin(), ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+      if (!ids.empty()) terminal = sets->intern(std::move(ids));
+      return terminal;
+    }
     for (int idx = 0; idx < NFA_STATE_NUM; ++idx) {
       if (T[idx]) {
         auto terminal_id = nfa.nodes[idx].terminal_id;
@@ -368,6 +431,9 @@ static Dfa from_nfa_impl(nfa::Nfa&& nfa) {
     return terminal;
   };
 
+  auto reps = nfa.classes.representatives();
+  auto members = nfa.classes.members();
+
   std::vector<std::unordered_map<u8, u32>> trans;
   std::vector<std::optional<u32>> terminals;
   std::vector<bitset> unmarked_dfa_state;
@@ -387,18 +453,23 @@ static Dfa from_nfa_impl(nfa::Nfa&& nfa) {
     bitset T = unmarked_dfa_state.back();
     unmarked_dfa_state.pop_back();
 
-    for (int a = 0; a < 256; ++a) {
-      auto T_a_move = move(T, a);
+    // one move per byte class, the representative stands for all its bytes
+    for (u32 k = 0; k < (u32)reps.size(); ++k) {
+      auto T_a_move = move(T, reps[k]);
+      // the empty set is the dead state, leave the edges missing
+      if (T_a_move.none()) continue;
       auto U = e_closure(T_a_move);
       if (auto it = id_link.find(U); it == id_link.end()) {
         // U not in dfa states
+        if (cur_id >= max_states) return std::nullopt;
         id_link[U] = cur_id++;
         trans.push_back(std::unordered_map<u8, u32>());
         terminals.push_back(std::move(is_terminal(U)));
         assert(trans.size() == cur_id);
         unmarked_dfa_state.push_back(U);
       }
-      trans[id_link[T]][a] = id_link[U];
+      u32 T_idx = id_link[T], U_idx = id_link[U];
+      for (auto a : members[k]) trans[T_idx][a] = U_idx;
     }
   }
 
@@ -409,14 +480,17 @@ static Dfa from_nfa_impl(nfa::Nfa&& nfa) {
     nodes.emplace_back(std::move(terminals[idx]), std::move(trans[idx]));
   }
 
-  Dfa dfa(std::move(nodes));
+  Dfa dfa(std::move(nodes), nfa.classes);
   dfa.minimize();
   return dfa;
 }
 
-Dfa Dfa::from_nfa(nfa::Nfa&& nfa) {
+std::optional<Dfa> Dfa::try_from_nfa(const nfa::Nfa& nfa, u32 max_states,
+                                     RuleSets* sets) {
+  // minimize() works on at most MAX_STATES nodes
+  max_states = std::min(max_states, MAX_STATES);
 #define CHECK_SIZE_BEFORE_WORK(N) \
-  if (nfa.nodes.size() <= N) return from_nfa_impl<N>(std::move(nfa))
+  if (nfa.nodes.size() <= N) return from_nfa_impl<N>(nfa, max_states, sets)
 
   CHECK_SIZE_BEFORE_WORK(16);
   CHECK_SIZE_BEFORE_WORK(32);
@@ -426,8 +500,17 @@ Dfa Dfa::from_nfa(nfa::Nfa&& nfa) {
   CHECK_SIZE_BEFORE_WORK(512);
   CHECK_SIZE_BEFORE_WORK(1024);
 
-  ERR_EXIT(nfa.nodes.size(), "from_nfa needs nfa.nodes.size() <= 1024");
+  return std::nullopt;
 
 #undef CHECK_SIZE_BEFORE_WORK
 }
+
+Dfa Dfa::from_nfa(nfa::Nfa&& nfa) {
+  if (nfa.nodes.size() > 1024) {
+    ERR_EXIT(nfa.nodes.size(), "from_nfa needs nfa.nodes.size() <= 1024");
+  }
+  auto dfa = try_from_nfa(nfa);
+  if (!dfa) ERR_EXIT("minimize needs dfa.nodes.size() <= 1024");
+  return std::move(*dfa);
+}
 }  // namespace parsergen::dfa
@@ -0,0 +1,139 @@
+#include "core/glushkov.h"
+
+namespace parsergen::nfa {
+
+// first, last and nullable of a subexpression
+struct PositionInfo {
+  std::vector<u32> first;
+  std::vector<u32> last;
+  bool nullable;
+};
+
+// a disjunction of single chars, [...] and \d come out of the parser so
+static PositionInfo char_set_of(const re::Disjunction* dis,
+                                Positions& positions) {
+  u32 p = positions.size();
+  positions.bytes.emplace_back();
+  positions.follow.emplace_back();
+  positions.terminal.emplace_back();
+  for (auto& son : dis->sons) {
+    positions.bytes[p].set((u8)static_cast<const re::Char*>(son.get())->c);
+  }
+  return PositionInfo{{p}, {p}, false};
+}
+
+static PositionInfo analyze(const re::Re* re, Positions& positions) {
+  switch (re->kind) {
+    case re::Re::kEps:
+      return PositionInfo{{}, {}, true};
+    case re::Re::kChar: {
+      u32 p = positions.size();
+      positions.bytes.emplace_back();
+      positions.bytes[p].set((u8)static_cast<const re::Char*>(re)->c);
+      positions.follow.emplace_back();
+      positions.terminal.emplace_back();
+      return PositionInfo{{p}, {p}, false};
+    }
+    case re::Re::kKleene: {
+      auto info = analyze(static_cast<const re::Kleene*>(re)->son.get(),
+                          positions);
+      for (auto l : info.last) {
+        auto& follow = positions.follow[l];
+        follow.insert(follow.end(), info.first.begin(), info.first.end());
+      }
+      info.nullable = true;
+      return info;
+    }
+    case re::Re::kConcat: {
+      auto& sons = static_cast<const re::Concat*>(re)->sons;
+      // "" and "[]" parse to an empty concat, which is epsilon
+      if (sons.empty()) return PositionInfo{{}, {}, true};
+      auto info = analyze(sons[0].get(), positions);
+      for (size_t i = 1; i < sons.size(); ++i) {
+        auto next = analyze(sons[i].get(), positions);
+        for (auto l : info.last) {
+          auto& follow = positions.follow[l];
+          follow.insert(follow.end(), next.first.begin(), next.first.end());
+        }
+        if (info.nullable) {
+          info.first.insert(info.first.end(), next.first.begin(),
+                            next.first.end());
+        }
+        if (next.nullable) {
+          next.last.insert(next.last.end(), info.last.begin(),
+                           info.last.end());
+        }
+        info.last = std::move(next.last);
+        info.nullable = info.nullable && next.nullable;
+      }
+      return info;
+    }
+    case re::Re::kDisjunction: {
+      auto dis = static_cast<const re::Disjunction*>(re);
+      bool char_set = !dis->sons.empty();
+      for (auto& son : dis->sons) char_set &= son->kind == re::Re::kChar;
+      if (char_set) return char_set_of(dis, positions);
+      PositionInfo info{{}, {}, false};
+      for (auto& son : dis->sons) {
+        auto next = analyze(son.get(), positions);
+        info.first.insert(info.first.end(), next.first.begin(),
+                          next.first.end());
+        info.last.insert(info.last.end(), next.last.begin(), next.last.end());
+        info.nullable = info.nullable || next.nullable;
+      }
+      return info;
+    }
+    case re::Re::kGroup:
+      return analyze(static_cast<const re::Group*>(re)->son.get(), positions);
+    default:
+      UNREACHABLE();
+  }
+}
+
+Positions Positions::from_re(const std::vector<std::unique_ptr<re::Re>>& res) {
+  Positions positions;
+  for (u32 id = 0; id < (u32)res.size(); ++id) {
+    auto info = analyze(res[id].get(), positions);
+    positions.first.insert(positions.first.end(), info.first.begin(),
+                           info.first.end());
+    // ids only grow, the first rule to claim a position keeps it
+    for (auto l : info.last) {
+      if (!positions.terminal[l]) positions.terminal[l] = id;
+    }
+    if (info.nullable && !positions.empty) positions.empty = id;
+  }
+  return positions;
+}
+
+std::optional<Glushkov> Glushkov::from_positions(const Positions& positions) {
+  if (positions.size() <= BitParallel<1>::MAX_POSITIONS) {
+    return Glushkov(BitParallel<1>::from_positions(positions));
+  }
+  if (positions.size() <= BitParallel<4>::MAX_POSITIONS) {
+    return Glushkov(BitParallel<4>::from_positions(positions));
+  }
+  if (positions.size() <= BitParallel<8>::MAX_POSITIONS) {
+    return Glushkov(BitParallel<8>::from_positions(positions));
+  }
+  return std::nullopt;
+}
+
+std::optional<Glushkov> Glushkov::from_re(
+    const std::vector<std::unique_ptr<re::Re>>& res) {
+  return from_positions(Positions::from_re(res));
+}
+
+std::optional<Glushkov> Glushkov::from_sv(std::string_view sv, u32 id) {
+  auto re = re::Re::try_parse(sv);
+  if (!re) return std::nullopt;
+  std::vector<std::unique_ptr<re::Re>> res;
+  res.push_back(std::move(re));
+  auto positions = Positions::from_re(res);
+  for (auto& terminal : positions.terminal) {
+    if (terminal) terminal = id;
+  }
+  if (positions.empty) positions.empty = id;
+  return from_positions(positions);
+}
+
+}  // namespace parsergen::nfa
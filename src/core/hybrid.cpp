@@ -0,0 +1,28 @@
+#include "core/hybrid.h"
+
+namespace parsergen::dfa {
+
+Hybrid Hybrid::from_nfa(nfa::Nfa&& nfa, Budget budget) {
+  if (auto dfa = Dfa::try_from_nfa(nfa, budget.max_states)) {
+    return Hybrid(CompiledDfa::from_dfa(*dfa));
+  }
+  return Hybrid(LazyDfa::from_nfa(std::move(nfa), budget.cache_size));
+}
+
+Hybrid Hybrid::from_re(std::unique_ptr<re::Re> re, u32 id, Budget budget) {
+  return from_nfa(nfa::Nfa::from_re(std::move(re), id), budget);
+}
+
+Hybrid Hybrid::from_re(std::vector<std::unique_ptr<re::Re>>&& res,
+                       Budget budget) {
+  return from_nfa(nfa::Nfa::from_re(std::move(res)), budget);
+}
+
+std::optional<Hybrid> Hybrid::from_sv(std::string_view sv, u32 id,
+                                      Budget budget) {
+  auto re = re::Re::try_parse(sv);
+  if (!re) return std::nullopt;
+  return from_re(std::move(re), id, budget);
+}
+
+}  // namespace parsergen::dfa
@@ -0,0 +1,157 @@
+#include "core/lazy_dfa.h"
+
+#include <algorithm>
+
+namespace parsergen::dfa {
+
+LazyDfa::LazyDfa(nfa::Nfa&& nfa, size_t cache_size, bool label_sets)
+    : nfa(std::move(nfa)), cache_size(cache_size) {
+  if (label_sets) rule_sets.emplace();
+  mark.assign(this->nfa.nodes.size(), 0);
+  start = closure({0});
+  flush();
+  flush_count = 0;
+}
+
+LazyDfa::Set LazyDfa::closure(Set set) {
+  if (++epoch == 0) {
+    std::fill(mark.begin(), mark.end(), 0);
+    epoch = 1;
+  }
+  for (auto idx : set) mark[idx] = epoch;
+  // set doubles as the dfs stack, everything before i is done
+  for (size_t i = 0; i < set.size(); ++i) {
+    for (auto u : nfa.nodes[set[i]].eps_edges) {
+      if (mark[u] != epoch) {
+        mark[u] = epoch;
+        set.push_back(u);
+      }
+    }
+  }
+  std::sort(set.begin(), set.end());
+  return set;
+}
+
+void LazyDfa::flush() {
+  std::vector<u32> kept_rules;
+  if (rule_sets && kept) kept_rules = (*rule_sets)[*kept];
+  trans.clear();
+  terminals.clear();
+  sets.clear();
+  ids.clear();
+  // the labels of the states just dropped
+  if (rule_sets) rule_sets->clear();
+  used = 0;
+  ++flush_count;
+  add_state({});
+  add_state(Set(start));
+  // the dead state never leaves itself
+  std::fill_n(trans.begin(), nfa.classes.num, DEAD_STATE);
+  // the token scan() holds outlives the states it came from
+  if (!kept_rules.empty()) {
+    size_t before = rule_sets->memory();
+    kept = rule_sets->intern(std::move(kept_rules));
+    used += rule_sets->memory() - before;
+  }
+}
+
+u32 LazyDfa::add_state(Set&& set) {
+  if (auto it = ids.find(set); it != ids.end()) return it->second;
+  std::optional<u32> terminal;
+  std::vector<u32> rules;
+  for (auto idx : set) {
+    auto terminal_id = nfa.nodes[idx].terminal_id;
+    if (terminal_id && (!terminal || *terminal_id < *terminal)) {
+      terminal = terminal_id;
+    }
+    if (terminal_id && rule_sets) rules.push_back(*terminal_id);
+  }
+  std::sort(rules.begin(), rules.end());
+  rules.erase(std::unique(rules.begin(), rules.end()), rules.end());
+
+  // a new set of rules is charged as well, at most once per state
+  size_t size = cost(set) + RuleSets::cost(rules);
+  if (sets.size() > START_STATE && used + size > cache_size) flush();
+
+  if (!rules.empty()) {
+    size_t before = rule_sets->memory();
+    terminal = rule_sets->intern(std::move(rules));
+    used += rule_sets->memory() - before;
+  }
+  auto [it, _] = ids.emplace(std::move(set), (u32)sets.size());
+  sets.push_back(&it->first);
+  terminals.push_back(terminal);
+  trans.resize(trans.size() + nfa.classes.num, UNKNOWN);
+  used += cost(*sets.back());
+  return it->second;
+}
+
+u32 LazyDfa::build(u32 state, u8 c) {
+  Set moved;
+  for (auto idx : *sets[state]) {
+    auto& edges = nfa.nodes[idx].edges;
+    if (auto it = edges.find(c); it != edges.end()) {
+      moved.insert(moved.end(), it->second.begin(), it->second.end());
+    }
+  }
+  // closure() drops the duplicates
+  std::sort(moved.begin(), moved.end());
+  moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+  size_t before = flush_count;
+  u32 t = add_state(closure(std::move(moved)));
+  // after a flush state is gone, only t is valid
+  if (flush_count == before) {
+    trans[state * nfa.classes.num + nfa.classes.map[c]] = t;
+  }
+  return t;
+}
+
+std::optional<u32> LazyDfa::accept(std::string_view sv) {
+  u32 cur = START_STATE;
+  for (auto c : sv) {
+    cur = next(cur, c);
+    if (cur == DEAD_STATE) return std::nullopt;
+  }
+  return terminals[cur];
+}
+
+std::optional<Token> LazyDfa::scan(std::string_view sv, size_t pos) {
+  std::optional<Token> token;
+  u32 cur = START_STATE;
+  if (auto id = terminals[cur]) token = Token{*id, pos, 0};
+  for (size_t i = pos; i < sv.size(); ++i) {
+    if (token) kept = token->id;
+    size_t before = flush_count;
+    cur = next(cur, sv[i]);
+    // a flush relabelled the rules of the token found so far
+    if (token && flush_count != before) token->id = *kept;
+    if (cur == DEAD_STATE) break;
+    if (auto id = terminals[cur]) token = Token{*id, pos, i + 1 - pos};
+  }
+  kept.reset();
+  return token;
+}
+
+LazyDfa LazyDfa::from_nfa(nfa::Nfa&& nfa, size_t cache_size) {
+  return LazyDfa(std::move(nfa), cache_size, false);
+}
+
+LazyDfa LazyDfa::from_nfa_sets(nfa::Nfa&& nfa, size_t cache_size) {
+  return LazyDfa(std::move(nfa), cache_size, true);
+}
+
+LazyDfa LazyDfa::from_re(std::unique_ptr<re::Re> re, u32 id,
+                         size_t cache_size) {
+  return from_nfa(nfa::Nfa::from_re(std::move(re), id), cache_size);
+}
+
+LazyDfa LazyDfa::from_re(std::vector<std::unique_ptr<re::Re>>&& res,
+                         size_t cache_size) {
+  return from_nfa(nfa::Nfa::from_re(std::move(res)), cache_size);
+}
+
+LazyDfa LazyDfa::from_sv(std::string_view sv, u32 id, size_t cache_size) {
+  return from_re(re::Re::parse(sv), id, cache_size);
+}
+
+}  // namespace parsergen::dfa
@@ -1,7 +1,46 @@
 #include "core/nfa.h"
 
+#include <map>
+
 namespace parsergen::nfa {
 
+ByteClasses Nfa::byte_classes(const std::vector<NfaNode>& nodes) {
+  ByteClasses classes;
+  std::array<u32, 256> key;
+  for (auto& node : nodes) {
+    if (node.edges.empty()) continue;
+    // bytes leading to the same targets share a key, missing edges are 0
+    std::map<std::vector<u32>, u32> target_key;
+    key.fill(0);
+    for (auto& [c, targets] : node.edges) {
+      key[c] = target_key.emplace(targets, target_key.size() + 1).first->second;
+    }
+    classes.refine(key);
+  }
+  return classes;
+}
+
+Nfa Nfa::reverse(u32 id) const {
+  // old node i is new node i + 1, the new start leads to every old terminal
+  std::vector<NfaNode> rev;
+  rev.emplace_back(std::nullopt, std::vector<u32>(),
+                   std::unordered_map<u8, std::vector<u32>>());
+  for (u32 i = 0; i < (u32)nodes.size(); ++i) {
+    rev.emplace_back(std::nullopt, std::vector<u32>(),
+                     std::unordered_map<u8, std::vector<u32>>());
+    if (nodes[i].terminal_id) rev[0].eps_edges.push_back(i + 1);
+  }
+  rev[1].terminal_id = id;
+  for (u32 i = 0; i < (u32)nodes.size(); ++i) {
+    for (auto e : nodes[i].eps_edges) rev[e + 1].eps_edges.push_back(i + 1);
+    for (auto& [c, targets] : nodes[i].edges) {
+      for (auto e : targets) rev[e + 1].edges[c].push_back(i + 1);
+    }
+  }
+  // flipping edges keeps bytes of one class together
+  return Nfa(std::move(rev), classes);
+}
+
 Nfa Nfa::from_sv(std::string_view sv, u32 id) {
   auto re = re::Re::parse(sv);
   return from_re(std::move(re), id);
@@ -9,6 +48,7 @@ Nfa Nfa::from_sv(std::string_view sv, u32 id) {
 
 // "Compilers: Principles, Techniques and Tools" Algorithm 3.23
 Nfa Nfa::from_re(std::unique_ptr<re::Re> re, u32 id) {
+  auto classes = ByteClasses::from_re(*re);
   // TODO: more efficiency
   std::unordered_map<re::Re*, std::vector<NfaNode>> dfa_sons;
   re::dfs(re, [&](std::unique_ptr<re::Re>& _re) {
@@ -63,6 +103,14 @@ Nfa Nfa::from_re(std::unique_ptr<re::Re> re, u32 id) {
       }
       case re::Re::kConcat: {
         auto con_re = static_cast<re::Concat*>(_re.get());
+        if (con_re->sons.empty()) {
+          // "" and "[]" parse to an empty concat, which is epsilon
+          nodes.emplace_back(std::nullopt, std::vector<u32>{1},
+                             std::unordered_map<u8, std::vector<u32>>());
+          nodes.emplace_back(std::make_optional<u32>(id), std::vector<u32>(),
+                             std::unordered_map<u8, std::vector<u32>>());
+          break;
+        }
         auto first_son = std::move(dfa_sons[con_re->sons[0].get()]);
         u32 first_son_node_size = first_son.size();
         dfa_sons.erase(con_re->sons[0].get());
@@ -102,6 +150,21 @@ Nfa Nfa::from_re(std::unique_ptr<re::Re> re, u32 id) {
         nodes.emplace_back(std::nullopt, std::vector<u32>(),
                            std::unordered_map<u8, std::vector<u32>>());
 
+        // a char set is one node with an edge per byte, so that an engine
+        // following nfa states sees one state per set instead of one per char
+        bool char_set = true;
+        for (auto& son : dis_re->sons) char_set &= isa<re::Char>(son);
+        if (char_set) {
+          for (auto& son : dis_re->sons) {
+            dfa_sons.erase(son.get());
+            auto c = (u8) static_cast<re::Char*>(son.get())->c;
+            nodes[0].edges[c] = std::vector<u32>{1};
+          }
+          nodes.emplace_back(std::make_optional<u32>(id), std::vector<u32>(),
+                             std::unordered_map<u8, std::vector<u32>>());
+          break;
+        }
+
         u32 start_offset = 1;
         std::vector<u32> start_eps_edges;
         std::vector<u32> sons_end_nodes;
@@ -133,11 +196,40 @@ Nfa Nfa::from_re(std::unique_ptr<re::Re> re, u32 id) {
                            std::unordered_map<u8, std::vector<u32>>());
         break;
       }
+      case re::Re::kGroup: {
+        auto g_re = static_cast<re::Group*>(_re.get());
+        auto son = std::move(dfa_sons[g_re->son.get()]);
+        dfa_sons.erase(g_re->son.get());
+        u32 son_node_size = son.size();
+
+        // the tags sit on their own nodes inside an untagged entry and end,
+        // concat merges those into its neighbours
+        nodes.emplace_back(std::nullopt, std::vector<u32>{1},
+                           std::unordered_map<u8, std::vector<u32>>());
+        nodes.emplace_back(std::nullopt, std::vector<u32>{2},
+                           std::unordered_map<u8, std::vector<u32>>());
+        nodes.back().tag = 2 * g_re->index;
+        for (auto& son_node : son) son_node.move_offset(2);
+        for (u32 i = 0; i < son_node_size; ++i)
+          nodes.push_back(std::move(son[i]));
+        nodes.back().terminal_id = std::nullopt;
+        nodes.back().eps_edges.push_back(son_node_size + 2);
+        nodes.emplace_back(std::nullopt, std::vector<u32>{son_node_size + 3},
+                           std::unordered_map<u8, std::vector<u32>>());
+        nodes.back().tag = 2 * g_re->index + 1;
+
+        // end node
+        nodes.emplace_back(std::make_optional<u32>(id), std::vector<u32>(),
+                           std::unordered_map<u8, std::vector<u32>>());
+        break;
+      }
+      default:
+        UNREACHABLE();
     }
     dfa_sons.emplace(_re.get(), std::move(nodes));
   });
   assert(dfa_sons.size() == 1);
-  return Nfa(std::move(dfa_sons[re.get()]));
+  return Nfa(std::move(dfa_sons[re.get()]), std::move(classes));
 }
 
 Nfa Nfa::from_re(std::vector<std::unique_ptr<re::Re>>&& res) {
@@ -145,9 +237,11 @@ Nfa Nfa::from_re(std::vector<std::unique_ptr<re::Re>>&& res) {
   std::vector<NfaNode> nodes;
   nodes.emplace_back(std::nullopt, std::vector<u32>(),
                      std::unordered_map<u8, std::vector<u32>>());
+  ByteClasses classes;
   u32 start_offset = 1;
   for (u32 id = 0; id < (u32)res.size(); ++id) {
     auto nfa = from_re(std::move(res[id]), id);
+    classes.refine(nfa.classes);
     nodes[0].eps_edges.push_back(start_offset);
     u32 nfa_node_size = nfa.nodes.size();
     for (auto& son_node : nfa.nodes) {
@@ -160,7 +254,7 @@ Nfa Nfa::from_re(std::vector<std::unique_ptr<re::Re>>&& res) {
     assert(nodes.size() == start_offset);
   }
 
-  return Nfa(std::move(nodes));
+  return Nfa(std::move(nodes), std::move(classes));
 }
 
 }  // namespace parsergen::nfa
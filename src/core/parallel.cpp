@@ -0,0 +1,142 @@
+#include "core/parallel.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace parsergen::dfa {
+
+// below this a thread costs more than it saves
+static constexpr size_t MIN_CHUNK = 1 << 16;
+
+// Workers started on first use and kept for the rest of the process, so a
+// call does not pay for creating its threads.
+class WorkerPool {
+ public:
+  explicit WorkerPool(u32 size) {
+    for (u32 i = 0; i < size; ++i) workers.emplace_back([this] { work(); });
+  }
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+  }
+
+  static WorkerPool& get() {
+    static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+  }
+
+  // runs every task on the workers and returns once they are all done
+  void run(std::vector<std::function<void()>>& tasks) {
+    size_t left = tasks.size();
+    std::condition_variable done;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto& task : tasks) {
+      queue.push_back([&task, &left, &done, this] {
+        task();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--left == 0) done.notify_one();
+      });
+    }
+    wake.notify_all();
+    done.wait(lock, [&left] { return left == 0; });
+  }
+
+ private:
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wake.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty()) return;
+      auto task = std::move(queue.front());
+      queue.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> queue;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+};
+
+template <typename Table>
+static size_t tokenize_parallel_impl(const Table& table, std::string_view sv,
+                                     std::vector<Token>& tokens,
+                                     size_t chunk_num) {
+  std::vector<size_t> bounds(chunk_num + 1);
+  for (size_t k = 0; k <= chunk_num; ++k) {
+    bounds[k] = sv.size() / chunk_num * k;
+  }
+  bounds[chunk_num] = sv.size();
+
+  struct Chunk {
+    std::vector<Token> tokens;
+    size_t stop;
+  };
+  std::vector<Chunk> chunks(chunk_num);
+  std::vector<std::function<void()>> tasks;
+  for (size_t k = 1; k < chunk_num; ++k) {
+    tasks.push_back([&table, &sv, &bounds, &chunks, k] {
+      chunks[k].stop =
+          tokenize(table, sv, bounds[k], bounds[k + 1], chunks[k].tokens);
+    });
+  }
+  // the true stream keeps one memo however it is cut into calls
+  size_t pos = 0;
+  FailedPairs failed(table.state_num());
+  tasks.push_back(
+      [&] { pos = tokenize(table, sv, 0, bounds[1], tokens, failed); });
+  WorkerPool::get().run(tasks);
+
+  for (size_t k = 1; k < chunk_num && pos >= bounds[k]; ++k) {
+    const auto& spec = chunks[k];
+    while (pos < bounds[k + 1]) {
+      // the speculative stream has a token boundary at bounds[k], at the
+      // start of each of its tokens and at its stop
+      auto it = std::lower_bound(
+          spec.tokens.begin(), spec.tokens.end(), pos,
+          [](const Token& token, size_t p) { return token.pos < p; });
+      if (pos == bounds[k] || pos == spec.stop ||
+          (it != spec.tokens.end() && it->pos == pos)) {
+        tokens.insert(tokens.end(), it, spec.tokens.end());
+        pos = spec.stop;
+        break;
+      }
+      // not in step yet, one more token of the true stream
+      size_t next = tokenize(table, sv, pos, pos + 1, tokens, failed);
+      if (next == pos) return pos;
+      pos = next;
+    }
+    // a whole chunk went by out of step, the later ones are unlikely to do
+    // better: finish serially instead of checking every token
+    if (pos >= bounds[k + 1] && pos != spec.stop) {
+      return tokenize(table, sv, pos, sv.size(), tokens, failed);
+    }
+  }
+  return pos;
+}
+
+size_t tokenize_parallel(const CompiledDfa& dfa, std::string_view sv,
+                         std::vector<Token>& tokens, u32 threads) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t chunk_num = std::min<size_t>(threads, sv.size() / MIN_CHUNK);
+  if (chunk_num <= 1) return dfa.tokenize(sv, tokens);
+  return std::visit(
+      [&](const auto& table) {
+        return tokenize_parallel_impl(table, sv, tokens, chunk_num);
+      },
+      dfa.table);
+}
+
+}  // namespace parsergen::dfa
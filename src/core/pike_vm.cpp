@@ -0,0 +1,193 @@
+#include "core/pike_vm.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace parsergen::nfa {
+
+PikeVm::PikeVm(Nfa&& nfa) : nfa(std::move(nfa)) {
+  for (auto& node : this->nfa.nodes) {
+    if (node.tag) groups = std::max(groups, *node.tag / 2);
+  }
+}
+
+void PikeVm::add(Threads& threads, u32 idx, size_t start,
+                 std::vector<u32>& stack) const {
+  stack.push_back(idx);
+  while (!stack.empty()) {
+    u32 u = stack.back();
+    stack.pop_back();
+    if (threads.contains(u)) continue;
+    threads.sparse[u] = threads.size;
+    threads.dense[threads.size++] = u;
+    threads.start[u] = start;
+    for (auto v : nfa.nodes[u].eps_edges) {
+      if (!threads.contains(v)) stack.push_back(v);
+    }
+  }
+}
+
+// a frame is either a state to visit or, with RESTORE set, a slot to set
+// back once everything below a tag has been visited
+static constexpr u32 RESTORE = 1u << 31;
+
+void PikeVm::add_captures(Threads& threads, u32 idx, size_t pos,
+                          std::vector<size_t>& scratch,
+                          std::vector<std::pair<u32, size_t>>& stack) const {
+  size_t width = 2 * groups;
+  stack.emplace_back(idx, 0);
+  while (!stack.empty()) {
+    auto [u, old] = stack.back();
+    stack.pop_back();
+    if (u & RESTORE) {
+      scratch[u & ~RESTORE] = old;
+      continue;
+    }
+    if (threads.contains(u)) continue;
+    threads.sparse[u] = threads.size;
+    threads.dense[threads.size++] = u;
+    auto& node = nfa.nodes[u];
+    if (node.tag && *node.tag >= 2) {
+      u32 slot = *node.tag - 2;
+      stack.emplace_back(slot | RESTORE, scratch[slot]);
+      scratch[slot] = pos;
+    }
+    std::copy(scratch.begin(), scratch.end(),
+              threads.slots.begin() + (size_t)u * width);
+    // the first eps edge has the highest priority, so it is popped first
+    for (auto it = node.eps_edges.rbegin(); it != node.eps_edges.rend();
+         ++it) {
+      if (!threads.contains(*it)) stack.emplace_back(*it, 0);
+    }
+  }
+}
+
+std::optional<u32> PikeVm::captures(std::string_view sv,
+                                    std::vector<dfa::Span>& spans) const {
+  constexpr size_t npos = std::string_view::npos;
+  size_t n = nfa.nodes.size();
+  size_t width = 2 * groups;
+  Threads cur(n, width), next(n, width);
+  std::vector<std::pair<u32, size_t>> stack;
+  std::vector<size_t> scratch(width, npos);
+  add_captures(cur, 0, 0, scratch, stack);
+  for (size_t i = 0; i < sv.size() && cur.size > 0; ++i) {
+    next.size = 0;
+    for (u32 k = 0; k < cur.size; ++k) {
+      u32 u = cur.dense[k];
+      auto& edges = nfa.nodes[u].edges;
+      auto it = edges.find(sv[i]);
+      if (it == edges.end()) continue;
+      for (auto t : it->second) {
+        auto first = cur.slots.begin() + (size_t)u * width;
+        std::copy(first, first + width, scratch.begin());
+        add_captures(next, t, i + 1, scratch, stack);
+      }
+    }
+    std::swap(cur, next);
+  }
+
+  std::optional<u32> id;
+  u32 winner = 0;
+  for (u32 k = 0; k < cur.size; ++k) {
+    auto terminal_id = nfa.nodes[cur.dense[k]].terminal_id;
+    if (terminal_id && (!id || *terminal_id < *id)) {
+      id = terminal_id;
+      winner = cur.dense[k];
+    }
+  }
+  if (!id) return std::nullopt;
+  spans.assign(groups + 1, dfa::Span{npos, npos});
+  spans[0] = dfa::Span{0, sv.size()};
+  auto slots = cur.slots.begin() + (size_t)winner * width;
+  for (u32 g = 1; g <= groups; ++g) {
+    size_t begin = slots[2 * (g - 1)], end = slots[2 * (g - 1) + 1];
+    if (begin != npos && end != npos) spans[g] = dfa::Span{begin, end};
+  }
+  return id;
+}
+
+std::optional<dfa::Match> PikeVm::run(std::string_view sv, size_t pos,
+                                      bool anchored) const {
+  size_t n = nfa.nodes.size();
+  Threads cur(n), next(n);
+  std::vector<u32> stack;
+  stack.reserve(n);
+  std::optional<dfa::Match> best;
+  // threads are ordered by start: the ones stepped from the current list
+  // keep its order and the fresh attempt always comes last
+  add(cur, 0, pos, stack);
+  for (size_t i = pos;; ++i) {
+    for (u32 k = 0; k < cur.size; ++k) {
+      if (!nfa.nodes[cur.dense[k]].terminal_id) continue;
+      // the leftmost attempt matching now, later attempts can never win
+      size_t start = cur.start[cur.dense[k]];
+      u32 id = *nfa.nodes[cur.dense[k]].terminal_id;
+      u32 end = k + 1;
+      for (; end < cur.size && cur.start[cur.dense[end]] == start; ++end) {
+        if (auto other = nfa.nodes[cur.dense[end]].terminal_id) {
+          id = std::min(id, *other);
+        }
+      }
+      best = dfa::Match{id, start, i};
+      cur.size = end;
+      break;
+    }
+    if (i == sv.size()) break;
+    if (cur.size == 0 && (anchored || best)) break;
+
+    next.size = 0;
+    for (u32 k = 0; k < cur.size; ++k) {
+      auto& edges = nfa.nodes[cur.dense[k]].edges;
+      if (auto it = edges.find(sv[i]); it != edges.end()) {
+        for (auto t : it->second) add(next, t, cur.start[cur.dense[k]], stack);
+      }
+    }
+    if (!anchored && !best) add(next, 0, i + 1, stack);
+    std::swap(cur, next);
+  }
+  return best;
+}
+
+std::optional<u32> PikeVm::accept(std::string_view sv) const {
+  // the longest anchored match is the whole of sv if anything is
+  auto match = run(sv, 0, true);
+  if (!match || match->end != sv.size()) return std::nullopt;
+  return match->id;
+}
+
+std::optional<dfa::Token> PikeVm::scan(std::string_view sv, size_t pos) const {
+  auto match = run(sv, pos, true);
+  if (!match) return std::nullopt;
+  return dfa::Token{match->id, pos, match->end - pos};
+}
+
+std::optional<dfa::Match> PikeVm::find(std::string_view sv, size_t pos) const {
+  return run(sv, pos, false);
+}
+
+std::vector<dfa::Match> PikeVm::find_all(std::string_view sv) const {
+  std::vector<dfa::Match> matches;
+  size_t pos = 0;
+  while (pos <= sv.size()) {
+    auto match = find(sv, pos);
+    if (!match) break;
+    matches.push_back(*match);
+    pos = match->end > match->begin ? match->end : match->end + 1;
+  }
+  return matches;
+}
+
+PikeVm PikeVm::from_re(std::unique_ptr<re::Re> re, u32 id) {
+  return from_nfa(Nfa::from_re(std::move(re), id));
+}
+
+PikeVm PikeVm::from_re(std::vector<std::unique_ptr<re::Re>>&& res) {
+  return from_nfa(Nfa::from_re(std::move(res)));
+}
+
+PikeVm PikeVm::from_sv(std::string_view sv, u32 id) {
+  return from_re(re::Re::parse(sv), id);
+}
+
+}  // namespace parsergen::nfa
@@ -0,0 +1,225 @@
+#include "core/prefilter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace parsergen {
+
+Prefilter::Prefilter(std::vector<std::string> literals, size_t lead)
+    : lits(std::move(literals)), lead_(lead) {
+  assert(!lits.empty() && lits.size() <= MAX_LITERALS);
+  is_first.fill(false);
+  for (auto& lit : lits) {
+    assert(!lit.empty());
+    u8 c = lit[0];
+    if (!is_first[c]) firsts.push_back(c);
+    is_first[c] = true;
+  }
+}
+
+size_t Prefilter::find(std::string_view sv, size_t pos) const {
+  if (pos >= sv.size()) return std::string_view::npos;
+  if (lits.size() == 1) {
+    auto& lit = lits[0];
+    if (lit.size() > 1) return sv.find(lit, pos);
+    auto p = std::memchr(sv.data() + pos, lit[0], sv.size() - pos);
+    return p ? (const char*)p - sv.data() : std::string_view::npos;
+  }
+
+  auto match_at = [&](size_t i) {
+    for (auto& lit : lits) {
+      if (sv.compare(i, lit.size(), lit) == 0) return true;
+    }
+    return false;
+  };
+  size_t i = pos;
+#ifdef __SSE2__
+  // compare 16 bytes against every first byte at once, then verify the hits
+  for (; i + 16 <= sv.size(); i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(sv.data() + i));
+    __m128i hit = _mm_setzero_si128();
+    for (auto c : firsts) {
+      hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+    }
+    for (u32 mask = _mm_movemask_epi8(hit); mask; mask &= mask - 1) {
+      size_t j = i + __builtin_ctz(mask);
+      if (match_at(j)) return j;
+    }
+  }
+#endif
+  for (; i < sv.size(); ++i) {
+    if (is_first[(u8)sv[i]] && match_at(i)) return i;
+  }
+  return std::string_view::npos;
+}
+
+size_t Prefilter::skip(std::string_view sv, size_t pos) const {
+  size_t p = find(sv, pos);
+  if (p == std::string_view::npos) return p;
+  return std::max(pos, p >= lead_ ? p - lead_ : 0);
+}
+
+// every match contains one of lits, starting at most lead bytes after the
+// start of the match
+struct RequiredLiterals {
+  std::vector<std::string> lits;
+  size_t lead;
+};
+
+struct LiteralInfo {
+  // the regex only matches this string
+  std::optional<std::string> exact;
+  // nothing when unbounded
+  std::optional<size_t> max_len;
+  std::optional<RequiredLiterals> required;
+};
+
+static size_t shortest(const RequiredLiterals& r) {
+  size_t len = -1;
+  for (auto& lit : r.lits) len = std::min(len, lit.size());
+  return len;
+}
+
+static bool better(const RequiredLiterals& a,
+                   const std::optional<RequiredLiterals>& b) {
+  if (!b) return true;
+  if (shortest(a) != shortest(*b)) return shortest(a) > shortest(*b);
+  if (a.lits.size() != b->lits.size()) return a.lits.size() < b->lits.size();
+  return a.lead < b->lead;
+}
+
+static std::optional<RequiredLiterals> unite(
+    const std::vector<const RequiredLiterals*>& rs) {
+  RequiredLiterals u{{}, 0};
+  for (auto r : rs) {
+    if (!r) return std::nullopt;
+    for (auto& lit : r->lits) {
+      if (std::find(u.lits.begin(), u.lits.end(), lit) == u.lits.end()) {
+        u.lits.push_back(lit);
+      }
+    }
+    u.lead = std::max(u.lead, r->lead);
+  }
+  if (u.lits.empty() || u.lits.size() > Prefilter::MAX_LITERALS) {
+    return std::nullopt;
+  }
+  return u;
+}
+
+static LiteralInfo analyze(const re::Re* re) {
+  LiteralInfo info;
+  switch (re->kind) {
+    case re::Re::kEps:
+      info.exact = "";
+      info.max_len = 0;
+      break;
+    case re::Re::kChar: {
+      std::string c(1, static_cast<const re::Char*>(re)->c);
+      info.exact = c;
+      info.max_len = 1;
+      info.required = RequiredLiterals{{c}, 0};
+      break;
+    }
+    case re::Re::kKleene: {
+      auto son = analyze(static_cast<const re::Kleene*>(re)->son.get());
+      // zero repetitions need no literal
+      if (son.max_len == 0) {
+        info.exact = "";
+        info.max_len = 0;
+      }
+      break;
+    }
+    case re::Re::kConcat: {
+      info.exact = "";
+      info.max_len = 0;
+      // the exact sons right before the current one, joined
+      std::string run;
+      std::optional<size_t> run_offset;
+      for (auto& son : static_cast<const re::Concat*>(re)->sons) {
+        auto son_info = analyze(son.get());
+        // a bounded offset of son from the start of the match
+        auto offset = info.max_len;
+        if (son_info.exact) {
+          if (run.empty()) run_offset = offset;
+          run += *son_info.exact;
+        } else {
+          run.clear();
+        }
+        if (offset && son_info.required) {
+          RequiredLiterals r = *son_info.required;
+          r.lead += *offset;
+          if (better(r, info.required)) info.required = r;
+        }
+        if (run_offset && !run.empty()) {
+          RequiredLiterals r{{run}, *run_offset};
+          if (better(r, info.required)) info.required = r;
+        }
+        if (info.exact && son_info.exact) {
+          *info.exact += *son_info.exact;
+        } else {
+          info.exact.reset();
+        }
+        if (info.max_len && son_info.max_len) {
+          *info.max_len += *son_info.max_len;
+        } else {
+          info.max_len.reset();
+        }
+      }
+      break;
+    }
+    case re::Re::kDisjunction: {
+      std::vector<LiteralInfo> sons;
+      for (auto& son : static_cast<const re::Disjunction*>(re)->sons) {
+        sons.push_back(analyze(son.get()));
+      }
+      info.max_len = 0;
+      std::vector<const RequiredLiterals*> required;
+      for (auto& son : sons) {
+        if (info.max_len && son.max_len) {
+          info.max_len = std::max(*info.max_len, *son.max_len);
+        } else {
+          info.max_len.reset();
+        }
+        required.push_back(son.required ? &*son.required : nullptr);
+      }
+      if (!sons.empty() && sons[0].exact) {
+        info.exact = sons[0].exact;
+        for (auto& son : sons) {
+          if (son.exact != info.exact) info.exact.reset();
+        }
+      }
+      info.required = unite(required);
+      break;
+    }
+    case re::Re::kGroup:
+      return analyze(static_cast<const re::Group*>(re)->son.get());
+    default:
+      UNREACHABLE();
+  }
+  return info;
+}
+
+std::optional<Prefilter> Prefilter::from_re(const re::Re& re) {
+  auto required = analyze(&re).required;
+  if (!required) return std::nullopt;
+  return Prefilter(std::move(required->lits), required->lead);
+}
+
+std::optional<Prefilter> Prefilter::from_re(
+    const std::vector<std::unique_ptr<re::Re>>& res) {
+  std::vector<LiteralInfo> infos;
+  std::vector<const RequiredLiterals*> required;
+  for (auto& re : res) infos.push_back(analyze(re.get()));
+  for (auto& info : infos) {
+    required.push_back(info.required ? &*info.required : nullptr);
+  }
+  auto united = unite(required);
+  if (!united) return std::nullopt;
+  return Prefilter(std::move(united->lits), united->lead);
+}
+
+}  // namespace parsergen
@@ -1,5 +1,7 @@
 #include "core/re.h"
 
+#include <algorithm>
+
 namespace parsergen::re {
 
 std::unique_ptr<Re> Re::clone() const {
@@ -22,12 +24,23 @@ std::unique_ptr<Re> Re::clone() const {
     case kDisjunction:
       new_re = cast<Disjunction>(this)->clone_impl();
       break;
+    case kGroup:
+      new_re = cast<Group>(this)->clone_impl();
+      break;
   }
 
   return new_re;
 }
 
-std::unordered_set<char> Re::_expand_metachar(std::string_view sv) {
+// records why sv is malformed for the caller to return
+static std::nullptr_t fail(std::string& error, std::string_view sv,
+                           const std::string& why) {
+  error = why + ": " + std::string(sv);
+  return nullptr;
+}
+
+std::unordered_set<char> Re::_expand_metachar(std::string_view sv,
+                                              std::string& error) {
   assert(sv[0] == '\\');
   assert(sv.size() == 2);
   std::unordered_set<char> hs;
@@ -78,15 +91,16 @@ std::unordered_set<char> Re::_expand_metachar(std::string_view sv) {
       break;
     }
     default: {
-      ERR_EXIT(
-          sv, "unsupported char for escaping: " + std::string(sv.substr(0, 2)));
+      fail(error, sv, "unsupported char for escaping");
+      break;
     }
   }
 
   return hs;
 }
 
-std::unique_ptr<Re> Re::parse_brackets(std::string_view sv) {
+std::unique_ptr<Re> Re::parse_brackets(std::string_view sv,
+                                       std::string& error) {
   // []
   std::string_view original_sv = sv;
 
@@ -102,8 +116,11 @@ std::unique_ptr<Re> Re::parse_brackets(std::string_view sv) {
 
   while (!sv.empty()) {
     if (sv[0] == '\\') {
-      if (sv.size() == 1) ERR_EXIT(original_sv, "escaped char is not complete");
-      auto chars = _expand_metachar(sv.substr(0, 2));
+      if (sv.size() == 1) {
+        return fail(error, original_sv, "escaped char is not complete");
+      }
+      auto chars = _expand_metachar(sv.substr(0, 2), error);
+      if (chars.empty()) return nullptr;
       for (auto c : chars) update(c);
       sv.remove_prefix(2);
       continue;
@@ -119,8 +136,8 @@ std::unique_ptr<Re> Re::parse_brackets(std::string_view sv) {
       case '}':
       case '^':
       case '$': {
-        ERR_EXIT(original_sv, sv[0],
-                 "not support some unescaped metachars in brackets");
+        return fail(error, original_sv,
+                    "not support some unescaped metachars in brackets");
       }
       case '\\': {
         UNREACHABLE();
@@ -154,6 +171,15 @@ std::unique_ptr<Re> Re::parse_brackets(std::string_view sv) {
 }
 
 std::unique_ptr<Re> Re::parse_without_pipe(std::string_view sv) {
+  u32 groups = 0;
+  std::string error;
+  auto re = parse_without_pipe(sv, groups, error);
+  if (!re) ERR_EXIT(error);
+  return re;
+}
+
+std::unique_ptr<Re> Re::parse_without_pipe(std::string_view sv, u32& groups,
+                                           std::string& error) {
   // meta char
   // ()[].|*+\?     use \ to escape metachar
   // we do not support {} ^ $
@@ -162,21 +188,26 @@ std::unique_ptr<Re> Re::parse_without_pipe(std::string_view sv) {
   auto concat = std::make_unique<Concat>();
   auto& stack = concat->sons;
 
-  auto check_close = [&](char close_char) {
+  // 0 when close_char is missing
+  auto check_close = [&](char close_char) -> size_t {
     size_t right_idx = 1;
     while (right_idx < sv.size() && sv[right_idx] != close_char) right_idx++;
     if (right_idx == sv.size()) {
-      ERR_EXIT(original_sv, sv,
-               "pair not match, need " + std::string(1, close_char));
+      fail(error, original_sv,
+           "pair not match, need " + std::string(1, close_char));
+      return 0;
     }
     return right_idx;
   };
 
   while (!sv.empty()) {
     if (sv[0] == '\\') {
-      if (sv.size() == 1) ERR_EXIT(original_sv, "escaped char is not complete");
+      if (sv.size() == 1) {
+        return fail(error, original_sv, "escaped char is not complete");
+      }
 
-      auto chars = _expand_metachar(sv.substr(0, 2));
+      auto chars = _expand_metachar(sv.substr(0, 2), error);
+      if (chars.empty()) return nullptr;
       auto d = std::make_unique<Disjunction>();
       for (auto c : chars) {
         d->sons.push_back(std::make_unique<Char>(c));
@@ -188,14 +219,14 @@ std::unique_ptr<Re> Re::parse_without_pipe(std::string_view sv) {
 
     switch (sv[0]) {
       case '+': {
-        if (stack.empty()) ERR_EXIT(original_sv, "empty plus");
+        if (stack.empty()) return fail(error, original_sv, "empty plus");
         auto k = std::make_unique<Kleene>(stack.back()->clone());
         stack.push_back(std::move(k));
         sv.remove_prefix(1);
         break;
       }
       case '*': {
-        if (stack.empty()) ERR_EXIT(original_sv, "empty kleene");
+        if (stack.empty()) return fail(error, original_sv, "empty kleene");
         std::unique_ptr<Re> bk = std::move(stack.back());
         stack.pop_back();
         auto k = std::make_unique<Kleene>(std::move(bk));
@@ -204,7 +235,9 @@ std::unique_ptr<Re> Re::parse_without_pipe(std::string_view sv) {
         break;
       }
       case '?': {
-        if (stack.empty()) ERR_EXIT(original_sv, "empty question mark");
+        if (stack.empty()) {
+          return fail(error, original_sv, "empty question mark");
+        }
         std::unique_ptr<Re> bk = std::move(stack.back());
         stack.pop_back();
         auto k = std::make_unique<Disjunction>();
@@ -219,11 +252,13 @@ std::unique_ptr<Re> Re::parse_without_pipe(std::string_view sv) {
         for (int i = 0; i < 256; ++i) {
           d->sons.push_back(std::make_unique<Char>(i));
         }
+        stack.push_back(std::move(d));
         sv.remove_prefix(1);
         break;
       }
       case '[': {
         size_t right_idx = check_close(']');
+        if (right_idx == 0) return nullptr;
         if (right_idx == 1) {
           // empty
           sv.remove_prefix(2);
@@ -231,29 +266,38 @@ std::unique_ptr<Re> Re::parse_without_pipe(std::string_view sv) {
         }
 
         // [ sv[1]...sv[right_idx - 1] ]
-        auto b = parse_brackets(sv.substr(1, right_idx - 1));
+        auto b = parse_brackets(sv.substr(1, right_idx - 1), error);
+        if (!b) return nullptr;
         stack.push_back(std::move(b));
         sv.remove_prefix(right_idx + 1);
         break;
       }
       case '(': {
         size_t right_idx = check_close(')');
+        if (right_idx == 0) return nullptr;
+        u32 index = ++groups;
         if (right_idx == 1) {
+          stack.push_back(
+              std::make_unique<Group>(std::make_unique<Eps>(), index));
           sv.remove_prefix(2);
           break;
         }
 
         // ( sv[1]...sv[right_idx - 1] )
-        auto b = parse_without_pipe(sv.substr(1, right_idx - 1));
-        stack.push_back(std::move(b));
+        auto b =
+            parse_without_pipe(sv.substr(1, right_idx - 1), groups, error);
+        if (!b) return nullptr;
+        stack.push_back(std::make_unique<Group>(std::move(b), index));
         sv.remove_prefix(right_idx + 1);
         break;
       }
       case ']': {
-        ERR_EXIT(original_sv, sv, "brackets not match, too many right bracket");
+        return fail(error, original_sv,
+                    "brackets not match, too many right bracket");
       }
       case ')': {
-        ERR_EXIT(original_sv, sv, "brace not match, too many right brace");
+        return fail(error, original_sv,
+                    "brace not match, too many right brace");
       }
       case '\\':
       case '|': {
@@ -271,17 +315,33 @@ std::unique_ptr<Re> Re::parse_without_pipe(std::string_view sv) {
 }
 
 std::unique_ptr<Re> Re::parse(std::string_view sv) {
-  std::vector<std::string_view> output = split(sv, "|");
-  if (output.size() == 1) return parse_without_pipe(output[0]);
+  std::string error;
+  auto re = try_parse(sv, &error);
+  if (!re) ERR_EXIT(error);
+  return re;
+}
 
-  auto dis = std::make_unique<Disjunction>();
-  for (auto s : output) {
-    assert(!s.empty());
-    auto one = parse_without_pipe(s);
-    dis->sons.push_back(std::move(one));
+std::unique_ptr<Re> Re::try_parse(std::string_view sv, std::string* error) {
+  std::string why;
+  std::vector<std::string_view> output = split(sv, "|");
+  u32 groups = 0;
+  std::unique_ptr<Re> re;
+  if (output.size() <= 1) {
+    // "" and a lone "|" have no pieces and stand for epsilon
+    re = parse_without_pipe(output.empty() ? std::string_view() : output[0],
+                            groups, why);
+  } else {
+    auto dis = std::make_unique<Disjunction>();
+    for (auto s : output) {
+      assert(!s.empty());
+      auto one = parse_without_pipe(s, groups, why);
+      if (!one) break;
+      dis->sons.push_back(std::move(one));
+    }
+    if (why.empty()) re = std::move(dis);
   }
-
-  return dis;
+  if (!re && error) *error = why;
+  return re;
 }
 
 void dfs(std::unique_ptr<Re>& re,
@@ -309,10 +369,44 @@ void dfs(std::unique_ptr<Re>& re,
       }
       break;
     }
+    case re::Re::kGroup: {
+      dfs(static_cast<re::Group*>(re.get())->son, fn);
+      break;
+    }
     default:
       UNREACHABLE();
   }
   fn(re);
 }
 
+u32 group_num(const Re& re) {
+  switch (re.kind) {
+    case Re::kEps:
+    case Re::kChar:
+      return 0;
+    case Re::kKleene:
+      return group_num(*static_cast<const Kleene&>(re).son);
+    case Re::kConcat: {
+      u32 n = 0;
+      for (auto& son : static_cast<const Concat&>(re).sons) {
+        n = std::max(n, group_num(*son));
+      }
+      return n;
+    }
+    case Re::kDisjunction: {
+      u32 n = 0;
+      for (auto& son : static_cast<const Disjunction&>(re).sons) {
+        n = std::max(n, group_num(*son));
+      }
+      return n;
+    }
+    case Re::kGroup: {
+      auto& group = static_cast<const Group&>(re);
+      return std::max(group.index, group_num(*group.son));
+    }
+    default:
+      UNREACHABLE();
+  }
+}
+
 }  // namespace parsergen::re
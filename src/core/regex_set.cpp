@@ -0,0 +1,46 @@
+#include "core/regex_set.h"
+
+#include <map>
+
+namespace parsergen::dfa {
+
+RegexSet RegexSet::from_nfa(nfa::Nfa&& nfa, Budget budget) {
+  RuleSets sets;
+  if (auto dfa = Dfa::try_from_nfa(nfa, budget.max_states, &sets)) {
+    return RegexSet(CompiledDfa::from_dfa(*dfa), std::move(sets));
+  }
+  auto lazy = LazyDfa::from_nfa_sets(std::move(nfa), budget.cache_size);
+  return RegexSet(std::move(lazy), RuleSets());
+}
+
+RegexSet RegexSet::from_re(std::vector<std::unique_ptr<re::Re>>&& res,
+                           Budget budget) {
+  if (auto literals = AhoCorasick::literals_of(res)) {
+    // one keyword per distinct string, labelled by all its rules
+    std::map<std::string_view, std::vector<u32>> rules;
+    for (u32 i = 0; i < (u32)literals->size(); ++i) {
+      rules[(*literals)[i]].push_back(i);
+    }
+    std::vector<std::string_view> words;
+    RuleSets sets;
+    for (auto& [word, ids] : rules) {
+      words.push_back(word);
+      sets.intern(std::move(ids));
+    }
+    return RegexSet(AhoCorasick::from_literals(words), std::move(sets));
+  }
+  return from_nfa(nfa::Nfa::from_re(std::move(res)), budget);
+}
+
+std::optional<RegexSet> RegexSet::from_sv(
+    const std::vector<std::string_view>& svs, Budget budget) {
+  std::vector<std::unique_ptr<re::Re>> res;
+  for (auto sv : svs) {
+    auto re = re::Re::try_parse(sv);
+    if (!re) return std::nullopt;
+    res.push_back(std::move(re));
+  }
+  return from_re(std::move(res), budget);
+}
+
+}  // namespace parsergen::dfa
@@ -0,0 +1,143 @@
+#include "core/scanner.h"
+
+#include <algorithm>
+
+namespace parsergen::dfa {
+
+Scanner::Scanner(const CompiledDfa& dfa, Callback callback)
+    : dfa(dfa),
+      callback(std::move(callback)),
+      failed_pairs(dfa.state_num()) {
+  std::visit(
+      [this](const auto& table) {
+        using Table = std::decay_t<decltype(table)>;
+        cur = Table::START_STATE;
+        dead_end.assign(table.state_num(), true);
+        for (u32 state = 0; state < table.state_num(); ++state) {
+          for (int c = 0; c < 256 && dead_end[state]; ++c) {
+            dead_end[state] = table.next(state, c) == Table::DEAD_STATE;
+          }
+        }
+      },
+      dfa.table);
+}
+
+u8 Scanner::byte_at(size_t pos) const {
+  return pos < chunk_pos ? pending[pending_begin + pos - token_pos]
+                         : chunk[pos - chunk_pos];
+}
+
+void Scanner::emit() {
+  auto [id, len] = last.value();
+  size_t end = token_pos + len;
+  std::string_view text;
+  if (token_pos >= chunk_pos) {
+    text = chunk.substr(token_pos - chunk_pos, len);
+  } else if (end <= chunk_pos) {
+    text = std::string_view(pending).substr(pending_begin, len);
+  } else {
+    // the token straddles the chunk boundary
+    pending.append(chunk.substr(0, end - chunk_pos));
+    text = std::string_view(pending).substr(pending_begin);
+  }
+  callback(Token{id, token_pos, len}, text);
+
+  if (token_pos < chunk_pos) {
+    if (end < chunk_pos) {
+      pending_begin += len;
+    } else {
+      pending.clear();
+      pending_begin = 0;
+    }
+  }
+  // the bytes after the token are scanned again
+  token_pos = scan_pos = end;
+  last.reset();
+  failed_pairs.advance(end);
+  for (auto [state, first, last] : trail) failed_pairs.set(state, first, last);
+  trail.clear();
+}
+
+template <typename Table>
+bool Scanner::run(const Table& table, bool eof) {
+  size_t end = chunk_pos + chunk.size();
+  while (true) {
+    if (scan_pos == token_pos) cur = Table::START_STATE;
+    while (scan_pos < end) {
+      // accel only looks at the current chunk, pending is rescanned bytewise
+      if (scan_pos >= chunk_pos) {
+        size_t at = scan_pos - chunk_pos;
+        if (size_t skip = accel_run(table, cur, chunk.data() + at,
+                                   chunk.size() - at)) {
+          size_t first = scan_pos;
+          scan_pos += skip;
+          if (!failed_pairs.empty() && failed_pairs.test(cur, scan_pos)) {
+            break;
+          }
+          if (auto id = table.terminals[cur]) {
+            last = {*id, scan_pos - token_pos};
+            trail.clear();
+          } else {
+            trail.emplace_back(cur, first, scan_pos);
+          }
+          if (scan_pos == end) break;
+        }
+      }
+      u32 next = table.next(cur, byte_at(scan_pos));
+      if (next == Table::DEAD_STATE) break;
+      if (!failed_pairs.empty() && failed_pairs.test(next, scan_pos + 1)) {
+        break;
+      }
+      cur = next;
+      ++scan_pos;
+      if (auto id = table.terminals[cur]) {
+        last = {*id, scan_pos - token_pos};
+        trail.clear();
+        if (dead_end[cur]) {
+          emit();
+          cur = Table::START_STATE;
+        }
+      } else {
+        trail.emplace_back(cur, scan_pos, scan_pos);
+      }
+    }
+    // a later chunk may still extend the token
+    if (scan_pos == end && !eof) break;
+    if (token_pos == end) break;
+    // the dead state or the end of the stream, the longest match is final
+    if (!last) {
+      failed = true;
+      return false;
+    }
+    emit();
+  }
+
+  // keep the unfinished token for the next chunk
+  size_t from = std::max(token_pos, chunk_pos);
+  // emitted tokens are dropped once they make up half of pending, so the
+  // copies stay linear in the stream
+  if (2 * pending_begin >= pending.size()) {
+    pending.erase(0, pending_begin);
+    pending_begin = 0;
+  }
+  pending.append(chunk.substr(from - chunk_pos));
+  return true;
+}
+
+bool Scanner::feed(std::string_view chunk) {
+  if (failed) return false;
+  this->chunk = chunk;
+  bool ok = std::visit([this](const auto& table) { return run(table, false); },
+                       dfa.table);
+  chunk_pos += chunk.size();
+  this->chunk = {};
+  return ok;
+}
+
+bool Scanner::finish() {
+  if (failed) return false;
+  return std::visit([this](const auto& table) { return run(table, true); },
+                    dfa.table);
+}
+
+}  // namespace parsergen::dfa
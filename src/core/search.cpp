@@ -0,0 +1,287 @@
+#include "core/search.h"
+
+#include <bitset>
+#include <limits>
+
+namespace parsergen::dfa {
+
+static constexpr u32 MAX_FORWARD_STATES = 1 << 16;
+
+template <int NFA_STATE_NUM>
+static std::optional<Dfa> unanchored_from_nfa_impl(const nfa::Nfa& nfa) {
+  using bitset = std::bitset<NFA_STATE_NUM>;
+  // the live attempts ordered by start, and whether a match has been seen so
+  // no later attempt can win anymore
+  using State = std::pair<bool, std::vector<bitset>>;
+  struct StateHash {
+    size_t operator()(const State& s) const {
+      size_t h = s.first;
+      for (auto& group : s.second) h = h * 31 + std::hash<bitset>()(group);
+      return h;
+    }
+  };
+
+  auto e_closure = [&nfa](bitset bs) {
+    std::vector<u32> stack;
+    for (u32 idx = 0; idx < NFA_STATE_NUM; ++idx) {
+      if (bs[idx]) stack.push_back(idx);
+    }
+    while (!stack.empty()) {
+      u32 t = stack.back();
+      stack.pop_back();
+      for (auto u : nfa.nodes[t].eps_edges) {
+        if (!bs[u]) {
+          bs.set(u);
+          stack.push_back(u);
+        }
+      }
+    }
+    return bs;
+  };
+
+  auto move = [&nfa](const bitset& T, u8 c) {
+    bitset bs;
+    for (u32 idx = 0; idx < NFA_STATE_NUM; ++idx) {
+      if (T[idx]) {
+        if (auto it = nfa.nodes[idx].edges.find(c);
+            it != nfa.nodes[idx].edges.end()) {
+          for (auto next_idx : it->second) bs.set(next_idx);
+        }
+      }
+    }
+    return bs;
+  };
+
+  auto terminal_of = [&nfa](const bitset& T) {
+    std::optional<u32> terminal;
+    for (u32 idx = 0; idx < NFA_STATE_NUM; ++idx) {
+      auto terminal_id = T[idx] ? nfa.nodes[idx].terminal_id : std::nullopt;
+      if (terminal_id && (!terminal || *terminal_id < *terminal)) {
+        terminal = terminal_id;
+      }
+    }
+    return terminal;
+  };
+
+  bitset init_node;
+  init_node.set(0);
+  const bitset start_node = e_closure(init_node);
+
+  // an nfa state already reached by an earlier attempt can only lead to the
+  // same ends as there, so later attempts drop it. The first attempt that
+  // matches ends all later ones and no new attempt starts from then on.
+  auto normalize = [&](State& s) -> std::optional<u32> {
+    bitset seen;
+    std::vector<bitset> groups;
+    for (auto& group : s.second) {
+      auto rest = group & ~seen;
+      if (rest.none()) continue;
+      seen |= rest;
+      groups.push_back(rest);
+    }
+    s.second = std::move(groups);
+    for (size_t i = 0; i < s.second.size(); ++i) {
+      if (auto terminal = terminal_of(s.second[i])) {
+        s.first = true;
+        s.second.resize(i + 1);
+        return terminal;
+      }
+    }
+    return std::nullopt;
+  };
+
+  auto reps = nfa.classes.representatives();
+  auto members = nfa.classes.members();
+
+  std::vector<std::unordered_map<u8, u32>> trans;
+  std::vector<std::optional<u32>> terminals;
+  std::vector<State> states;
+  std::unordered_map<State, u32, StateHash> id_link;
+  auto add_state = [&](State&& s,
+                       std::optional<u32> terminal) -> std::optional<u32> {
+    auto [it, inserted] = id_link.emplace(s, (u32)states.size());
+    if (inserted) {
+      if (states.size() >= MAX_FORWARD_STATES) return std::nullopt;
+      states.push_back(std::move(s));
+      trans.emplace_back();
+      terminals.push_back(terminal);
+    }
+    return it->second;
+  };
+
+  State start{false, {start_node}};
+  auto start_terminal = normalize(start);
+  add_state(std::move(start), start_terminal);
+  // states are numbered in discovery order, so this is a bfs
+  for (u32 idx = 0; idx < (u32)states.size(); ++idx) {
+    for (u32 k = 0; k < (u32)reps.size(); ++k) {
+      State next{states[idx].first, {}};
+      for (auto& group : states[idx].second) {
+        next.second.push_back(e_closure(move(group, reps[k])));
+      }
+      if (!next.first) next.second.push_back(start_node);
+      auto terminal = normalize(next);
+      // no attempt alive is the dead state
+      if (next.second.empty()) continue;
+      auto next_idx = add_state(std::move(next), terminal);
+      if (!next_idx) return std::nullopt;
+      for (auto a : members[k]) trans[idx][a] = *next_idx;
+    }
+  }
+
+  std::vector<DfaNode> nodes;
+  for (u32 idx = 0; idx < (u32)states.size(); ++idx) {
+    nodes.emplace_back(std::move(terminals[idx]), std::move(trans[idx]));
+  }
+  Dfa dfa(std::move(nodes), nfa.classes);
+  // a node merged into node 0 would hide live attempts, node 0 keeps a
+  // label of its own while the others are minimized
+  if (dfa.nodes.size() <= Dfa::MAX_STATES) {
+    auto start_terminal = std::get<0>(dfa.nodes[0]);
+    std::get<0>(dfa.nodes[0]) = std::numeric_limits<u32>::max();
+    dfa.minimize();
+    std::get<0>(dfa.nodes[0]) = start_terminal;
+  }
+  return dfa;
+}
+
+std::optional<Dfa> Searcher::unanchored_from_nfa(const nfa::Nfa& nfa) {
+#define CHECK_SIZE_BEFORE_WORK(N) \
+  if (nfa.nodes.size() <= N) return unanchored_from_nfa_impl<N>(nfa)
+
+  CHECK_SIZE_BEFORE_WORK(16);
+  CHECK_SIZE_BEFORE_WORK(32);
+  CHECK_SIZE_BEFORE_WORK(64);
+  CHECK_SIZE_BEFORE_WORK(128);
+  CHECK_SIZE_BEFORE_WORK(256);
+  CHECK_SIZE_BEFORE_WORK(512);
+  CHECK_SIZE_BEFORE_WORK(1024);
+
+  return std::nullopt;
+
+#undef CHECK_SIZE_BEFORE_WORK
+}
+
+std::optional<Searcher> Searcher::from_nfa(
+    nfa::Nfa&& nfa, std::optional<Prefilter> prefilter) {
+  auto forward = unanchored_from_nfa(nfa);
+  if (!forward) return std::nullopt;
+  // the rule id already comes from the forward dfa
+  auto reverse = Dfa::try_from_nfa(nfa.reverse());
+  if (!reverse) return std::nullopt;
+  return Searcher(
+      Dfas{CompiledDfa::from_dfa(*forward), CompiledDfa::from_dfa(*reverse)},
+      std::move(prefilter));
+}
+
+std::optional<Searcher> Searcher::from_re(std::unique_ptr<re::Re> re,
+                                          u32 id) {
+  auto prefilter = Prefilter::from_re(*re);
+  return from_nfa(nfa::Nfa::from_re(std::move(re), id), std::move(prefilter));
+}
+
+std::optional<Searcher> Searcher::from_re(
+    std::vector<std::unique_ptr<re::Re>>&& res) {
+  if (auto literals = AhoCorasick::from_re(res)) {
+    return Searcher(std::move(*literals));
+  }
+  auto prefilter = Prefilter::from_re(res);
+  return from_nfa(nfa::Nfa::from_re(std::move(res)), std::move(prefilter));
+}
+
+std::optional<Searcher> Searcher::from_sv(std::string_view sv, u32 id) {
+  auto re = re::Re::try_parse(sv);
+  if (!re) return std::nullopt;
+  return from_re(std::move(re), id);
+}
+
+std::optional<Searcher::End> Searcher::find_end(std::string_view sv,
+                                                size_t pos) const {
+  const Prefilter* prefilter = filter ? &*filter : nullptr;
+  if (prefilter) {
+    pos = prefilter->skip(sv, pos);
+    if (pos == std::string_view::npos) return std::nullopt;
+  }
+  return std::visit(
+      [sv, pos, prefilter](const auto& table) -> std::optional<End> {
+        using Table = std::decay_t<decltype(table)>;
+        u32 cur = Table::START_STATE;
+        std::optional<End> found;
+        size_t restart = pos;
+        if (auto id = table.terminals[cur]) found = End{*id, pos, pos};
+        for (size_t i = pos; i < sv.size(); ++i) {
+          cur = table.next(cur, sv[i]);
+          if (cur == Table::DEAD_STATE) break;
+          if (cur == Table::START_STATE) {
+            // every attempt before i + 1 died without a match
+            restart = i + 1;
+            if (prefilter) {
+              restart = prefilter->skip(sv, restart);
+              if (restart == std::string_view::npos) break;
+              // the start state again, one byte before restart
+              i = restart - 1;
+            }
+          }
+          if (auto id = table.terminals[cur]) found = End{*id, restart, i + 1};
+        }
+        return found;
+      },
+      std::get<Dfas>(engine).forward.table);
+}
+
+size_t Searcher::find_begin(std::string_view sv, size_t restart,
+                            size_t end) const {
+  return std::visit(
+      [sv, restart, end](const auto& table) {
+        using Table = std::decay_t<decltype(table)>;
+        u32 cur = Table::START_STATE;
+        size_t begin = end;
+        for (size_t i = end; i > restart; --i) {
+          cur = table.next(cur, sv[i - 1]);
+          if (cur == Table::DEAD_STATE) break;
+          if (table.terminals[cur]) begin = i - 1;
+        }
+        return begin;
+      },
+      std::get<Dfas>(engine).reverse.table);
+}
+
+std::optional<Match> Searcher::find(std::string_view sv, size_t pos) const {
+  if (auto literals = std::get_if<AhoCorasick>(&engine)) {
+    return literals->find(sv, pos);
+  }
+  auto found = find_end(sv, pos);
+  if (!found) return std::nullopt;
+  // any match starting earlier would have been the leftmost one, so the
+  // smallest begin that still reaches end is the start
+  return Match{found->id, find_begin(sv, found->restart, found->end),
+               found->end};
+}
+
+std::vector<Match> Searcher::find_all(std::string_view sv) const {
+  std::vector<Match> matches;
+  size_t pos = 0;
+  while (pos <= sv.size()) {
+    auto match = find(sv, pos);
+    if (!match) break;
+    matches.push_back(*match);
+    pos = match->end > match->begin ? match->end : match->end + 1;
+  }
+  return matches;
+}
+
+size_t Searcher::count(std::string_view sv) const {
+  if (is_literal()) return find_all(sv).size();
+  size_t n = 0;
+  size_t pos = 0;
+  while (pos <= sv.size()) {
+    auto found = find_end(sv, pos);
+    if (!found) break;
+    ++n;
+    // only an empty regex match can end where the search started
+    pos = found->end > pos ? found->end : found->end + 1;
+  }
+  return n;
+}
+
+}  // namespace parsergen::dfa
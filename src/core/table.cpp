@@ -0,0 +1,506 @@
+#include "core/table.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_SIMD
+#endif
+
+namespace parsergen::dfa {
+
+template <typename StateT>
+DenseTable<StateT> DenseTable<StateT>::from_dfa(const Dfa& dfa,
+                                                bool accelerate) {
+  // dfa.nodes[i] becomes row i + 1, an empty dfa still gets a start row
+  u32 state_num = std::max<u32>((u32)dfa.nodes.size(), 1) + 1;
+  assert(state_num - 1 <= std::numeric_limits<StateT>::max());
+  auto reps = dfa.classes.representatives();
+
+  DenseTable table;
+  table.stride_shift = 0;
+  while ((1u << table.stride_shift) < dfa.classes.num) ++table.stride_shift;
+  table.class_map = dfa.classes.map;
+  table.trans.assign((size_t)state_num << table.stride_shift, DEAD_STATE);
+  table.terminals.assign(state_num, std::nullopt);
+  for (u32 i = 0; i < (u32)dfa.nodes.size(); ++i) {
+    const auto& [terminal, next] = dfa.nodes[i];
+    u32 row = i + 1;
+    table.terminals[row] = terminal;
+    for (u32 k = 0; k < (u32)reps.size(); ++k) {
+      if (auto it = next.find(reps[k]); it != next.end()) {
+        table.trans[(row << table.stride_shift) | k] = it->second + 1;
+      }
+    }
+  }
+  // a 4 byte gather at the last entry stays inside the vector
+  table.trans.resize(table.trans.size() + sizeof(u32) / sizeof(StateT) - 1);
+  if (!accelerate) return table;
+
+  // the dead state is always accelerable, it only pays off with another one
+  std::vector<Accel> accel(state_num);
+  bool any = false;
+  for (u32 state = 0; state < state_num; ++state) {
+    std::vector<u8> escapes, loops;
+    for (int c = 0; c < 256; ++c) {
+      (table.next(state, c) == state ? loops : escapes).push_back(c);
+    }
+    Accel& a = accel[state];
+    if (escapes.size() <= 3) {
+      a.kind = Accel::kEscape;
+      a.num = escapes.size();
+      std::copy(escapes.begin(), escapes.end(), a.bytes);
+    } else if (loops.size() >= Accel::MIN_RANGE &&
+               loops.back() - loops.front() + 1u == loops.size()) {
+      a.kind = Accel::kRange;
+      a.bytes[0] = loops.front();
+      a.bytes[1] = loops.back();
+    }
+    any |= state != DEAD_STATE && a.kind != Accel::kNone;
+  }
+  if (any) table.accel = std::move(accel);
+  return table;
+}
+
+template struct DenseTable<u8>;
+template struct DenseTable<u16>;
+template struct DenseTable<u32>;
+
+CombTable CombTable::from_dfa(const Dfa& dfa) {
+  auto dense = DenseTable<u32>::from_dfa(dfa, false);
+  u32 class_num = dfa.classes.num;
+  u32 state_num = dense.state_num();
+
+  CombTable table;
+  table.class_map = dense.class_map;
+  table.terminals = std::move(dense.terminals);
+  table.rows.resize(state_num);
+
+  // identical rows are placed once
+  std::map<std::vector<u32>, std::vector<u32>> row_states;
+  for (u32 state = 0; state < state_num; ++state) {
+    auto first = dense.trans.begin() + ((size_t)state << dense.stride_shift);
+    row_states[std::vector<u32>(first, first + class_num)].push_back(state);
+  }
+
+  struct Pending {
+    const std::vector<u32>* row;
+    u32 deflt;
+    // columns that differ from deflt
+    std::vector<u32> cols;
+  };
+  std::vector<Pending> pendings;
+  for (auto& [row, _] : row_states) {
+    // the most common target becomes the default
+    std::unordered_map<u32, u32> freq;
+    u32 deflt = row[0];
+    for (auto t : row) {
+      if (++freq[t] > freq[deflt]) deflt = t;
+    }
+    std::vector<u32> cols;
+    for (u32 k = 0; k < class_num; ++k) {
+      if (row[k] != deflt) cols.push_back(k);
+    }
+    pendings.push_back({&row, deflt, std::move(cols)});
+  }
+  // first fit, the fullest rows first
+  std::stable_sort(pendings.begin(), pendings.end(),
+                   [](const Pending& a, const Pending& b) {
+                     return a.cols.size() > b.cols.size();
+                   });
+
+  std::vector<bool> base_used;
+  u32 first_free = 0;
+  std::vector<const Pending*> empty_rows;
+  std::unordered_map<const std::vector<u32>*, u32> row_base;
+  for (auto& p : pendings) {
+    if (p.cols.empty()) {
+      empty_rows.push_back(&p);
+      continue;
+    }
+    auto is_free = [&](u32 i) {
+      return i >= table.check.size() || table.check[i] == NO_OWNER;
+    };
+    u32 base = first_free > p.cols[0] ? first_free - p.cols[0] : 0;
+    while (true) {
+      bool fit = base >= base_used.size() || !base_used[base];
+      for (size_t j = 0; fit && j < p.cols.size(); ++j) {
+        fit = is_free(base + p.cols[j]);
+      }
+      if (fit) break;
+      ++base;
+    }
+
+    size_t end = base + class_num;
+    if (table.check.size() < end) {
+      table.check.resize(end, NO_OWNER);
+      table.target.resize(end, DEAD_STATE);
+    }
+    if (base_used.size() <= base) base_used.resize(base + 1, false);
+    base_used[base] = true;
+    for (auto k : p.cols) {
+      table.check[base + k] = base;
+      table.target[base + k] = (*p.row)[k];
+    }
+    while (!is_free(first_free)) ++first_free;
+    row_base[p.row] = base;
+  }
+  // rows without entries own no slot, any base past the used ones works
+  u32 empty_base = table.check.size();
+  table.check.resize(empty_base + class_num, NO_OWNER);
+  table.target.resize(empty_base + class_num, DEAD_STATE);
+  for (auto p : empty_rows) row_base[p->row] = empty_base;
+
+  for (auto& p : pendings) {
+    for (auto state : row_states[*p.row]) {
+      table.rows[state] = {row_base[p.row], p.deflt};
+    }
+  }
+  return table;
+}
+
+SparseTable SparseTable::from_dfa(const Dfa& dfa) {
+  auto dense = DenseTable<u32>::from_dfa(dfa, false);
+  u32 class_num = dfa.classes.num;
+  u32 state_num = dense.state_num();
+
+  SparseTable table;
+  table.class_map = dense.class_map;
+  table.terminals = std::move(dense.terminals);
+  table.entries.resize(state_num);
+  for (u32 state = 0; state < state_num; ++state) {
+    std::vector<u8> lo;
+    std::vector<u32> target;
+    for (int c = 0; c < 256; ++c) {
+      u32 t = dense.next(state, c);
+      if (target.empty() || target.back() != t) {
+        lo.push_back(c);
+        target.push_back(t);
+      }
+    }
+
+    // a range costs one byte for the bound and one u32 for the target
+    size_t range_bytes = lo.size() * (sizeof(u8) + sizeof(u32));
+    if (lo.size() <= MAX_RANGES && range_bytes < class_num * sizeof(u32)) {
+      table.entries[state] = {(u32)table.lo.size(), (u32)lo.size()};
+      table.lo.insert(table.lo.end(), lo.begin(), lo.end());
+      table.range_target.insert(table.range_target.end(), target.begin(),
+                                target.end());
+    } else {
+      auto first = dense.trans.begin() + ((size_t)state << dense.stride_shift);
+      table.entries[state] = {(u32)table.dense.size(), 0};
+      table.dense.insert(table.dense.end(), first, first + class_num);
+    }
+  }
+  table.lo.resize(table.lo.size() + MAX_RANGES, 0);
+  return table;
+}
+
+Stride2Table Stride2Table::from_dfa(const Dfa& dfa) {
+  auto dense = DenseTable<u32>::from_dfa(dfa, false);
+  u32 state_num = dense.state_num();
+  assert(state_num <= STATE_MASK);
+  Stride2Table table;
+  table.class_shift = dense.stride_shift;
+  table.class_map = dense.class_map;
+  table.terminals = std::move(dense.terminals);
+  table.trans = std::move(dense.trans);
+
+  u32 row = 1u << table.class_shift;
+  u32 pair_shift = 2 * table.class_shift;
+  u32 class_num = dfa.classes.num;
+  table.trans2.assign((size_t)state_num << pair_shift, DEAD_STATE);
+  for (u32 state = 0; state < state_num; ++state) {
+    for (u32 a = 0; a < class_num; ++a) {
+      u32 mid = table.trans[state * row + a];
+      u32 flag = table.terminals[mid] ? MID_TERMINAL : 0;
+      for (u32 b = 0; b < class_num; ++b) {
+        table.trans2[((size_t)state << pair_shift) | (a << table.class_shift) |
+                     b] = table.trans[mid * row + b] | flag;
+      }
+    }
+  }
+  return table;
+}
+
+#ifdef HAS_X86_SIMD
+template <typename StateT>
+__attribute__((target("avx2"))) static void accept_batch_avx2(
+    const DenseTable<StateT>& table, const std::string_view* inputs,
+    std::optional<u32>* out, size_t n) {
+  constexpr u32 LANES = 8;
+  const int* base = (const int*)table.trans.data();
+  const u8* cls = table.class_map.data();
+  const __m128i shift = _mm_cvtsi32_si128(table.stride_shift);
+  const __m256i state_mask = _mm256_set1_epi32(
+      sizeof(StateT) == 4 ? -1 : (1u << 8 * sizeof(StateT)) - 1);
+  const char* p[LANES];
+  size_t left[LANES];
+  alignas(32) u32 cur[LANES];
+  size_t idx[LANES];
+  u32 active = 0;
+  size_t next_input = 0;
+  while (true) {
+    for (u32 l = 0; l < active;) {
+      if (left[l] > 0 && cur[l] != table.DEAD_STATE) {
+        ++l;
+        continue;
+      }
+      out[idx[l]] = table.terminals[cur[l]];
+      --active;
+      p[l] = p[active];
+      left[l] = left[active];
+      cur[l] = cur[active];
+      idx[l] = idx[active];
+    }
+    while (active < LANES && next_input < n) {
+      p[active] = inputs[next_input].data();
+      left[active] = inputs[next_input].size();
+      cur[active] = table.START_STATE;
+      idx[active++] = next_input++;
+    }
+    if (active == 0) break;
+
+    size_t steps = left[0];
+    for (u32 l = 1; l < active; ++l) steps = std::min(steps, left[l]);
+    if (active == LANES) {
+      // all eight states in one register, one gather per step
+      __m256i states = _mm256_load_si256((const __m256i*)cur);
+      for (size_t i = 0; i < steps; ++i) {
+        __m256i classes = _mm256_setr_epi32(
+            cls[(u8)p[0][i]], cls[(u8)p[1][i]], cls[(u8)p[2][i]],
+            cls[(u8)p[3][i]], cls[(u8)p[4][i]], cls[(u8)p[5][i]],
+            cls[(u8)p[6][i]], cls[(u8)p[7][i]]);
+        __m256i index = _mm256_or_si256(_mm256_sll_epi32(states, shift),
+                                        classes);
+        states = _mm256_and_si256(
+            _mm256_i32gather_epi32(base, index, sizeof(StateT)), state_mask);
+      }
+      _mm256_store_si256((__m256i*)cur, states);
+    } else {
+      for (size_t i = 0; i < steps; ++i) {
+        for (u32 l = 0; l < active; ++l) cur[l] = table.next(cur[l], p[l][i]);
+      }
+    }
+    for (u32 l = 0; l < active; ++l) {
+      p[l] += steps;
+      left[l] -= steps;
+    }
+  }
+}
+
+#endif
+
+template <typename StateT>
+bool accept_batch_gather(const DenseTable<StateT>& table,
+                         const std::string_view* inputs,
+                         std::optional<u32>* out, size_t n) {
+#ifdef HAS_X86_SIMD
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) {
+    accept_batch_avx2(table, inputs, out, n);
+    return true;
+  }
+#endif
+  return false;
+}
+
+template bool accept_batch_gather(const DenseTable<u8>&,
+                                  const std::string_view*,
+                                  std::optional<u32>*, size_t);
+template bool accept_batch_gather(const DenseTable<u16>&,
+                                  const std::string_view*,
+                                  std::optional<u32>*, size_t);
+template bool accept_batch_gather(const DenseTable<u32>&,
+                                  const std::string_view*,
+                                  std::optional<u32>*, size_t);
+
+ShuffleTable ShuffleTable::from_dfa(const Dfa& dfa) {
+  auto dense = DenseTable<u8>::from_dfa(dfa, false);
+  assert(dense.state_num() <= MAX_STATES);
+  ShuffleTable table;
+  table.class_map = dense.class_map;
+  table.terminals = std::move(dense.terminals);
+  table.perm.resize(dfa.classes.num);
+  for (u32 k = 0; k < dfa.classes.num; ++k) {
+    table.perm[k].fill(DEAD_STATE);
+    for (u32 state = 0; state < table.state_num(); ++state) {
+      table.perm[k][state] = dense.trans[(state << dense.stride_shift) | k];
+    }
+  }
+  return table;
+}
+
+#ifdef HAS_X86_SIMD
+__attribute__((target("ssse3"))) static u32 shuffle_run(
+    const ShuffleTable& table, const char* p, size_t n) {
+  // four slices composed side by side, then chained through START_STATE
+  constexpr size_t SLICES = 4;
+  const u8* cls = table.class_map.data();
+  const __m128i* perm = (const __m128i*)table.perm.data();
+  const __m128i identity =
+      _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  size_t len = n / SLICES;
+  const char* s0 = p;
+  const char* s1 = p + len;
+  const char* s2 = p + 2 * len;
+  const char* s3 = p + 3 * len;
+  __m128i f0 = identity, f1 = identity, f2 = identity, f3 = identity;
+  // f = perm[c] after f, i.e. (perm[c] o f)[s] = perm[c][f[s]]
+  for (size_t i = 0; i < len; ++i) {
+    f0 = _mm_shuffle_epi8(_mm_loadu_si128(perm + cls[(u8)s0[i]]), f0);
+    f1 = _mm_shuffle_epi8(_mm_loadu_si128(perm + cls[(u8)s1[i]]), f1);
+    f2 = _mm_shuffle_epi8(_mm_loadu_si128(perm + cls[(u8)s2[i]]), f2);
+    f3 = _mm_shuffle_epi8(_mm_loadu_si128(perm + cls[(u8)s3[i]]), f3);
+  }
+  for (size_t i = SLICES * len; i < n; ++i) {
+    f3 = _mm_shuffle_epi8(_mm_loadu_si128(perm + cls[(u8)p[i]]), f3);
+  }
+  alignas(16) u8 f[SLICES][16];
+  _mm_store_si128((__m128i*)f[0], f0);
+  _mm_store_si128((__m128i*)f[1], f1);
+  _mm_store_si128((__m128i*)f[2], f2);
+  _mm_store_si128((__m128i*)f[3], f3);
+  u32 cur = ShuffleTable::START_STATE;
+  for (size_t k = 0; k < SLICES; ++k) cur = f[k][cur];
+  return cur;
+}
+#endif
+
+std::optional<u32> ShuffleTable::accept(std::string_view sv) const {
+#ifdef HAS_X86_SIMD
+  static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+  if (has_ssse3) return terminals[shuffle_run(*this, sv.data(), sv.size())];
+#endif
+  u32 cur = START_STATE;
+  for (auto c : sv) cur = next(cur, c);
+  return terminals[cur];
+}
+
+// the sample as the inputs accept() would see: a piece ends with the byte
+// that leaves the dfa, the next one starts after it
+static std::vector<std::string_view> pieces(const Dfa& dfa,
+                                            std::string_view sample) {
+  std::vector<std::string_view> out;
+  size_t begin = 0;
+  u32 cur = 0;
+  for (size_t i = 0; i < sample.size() && !dfa.nodes.empty(); ++i) {
+    const auto& next = std::get<1>(dfa.nodes[cur]);
+    auto it = next.find(sample[i]);
+    if (it != next.end()) {
+      cur = it->second;
+      continue;
+    }
+    out.push_back(sample.substr(begin, i + 1 - begin));
+    begin = i + 1;
+    cur = 0;
+  }
+  if (begin < sample.size()) out.push_back(sample.substr(begin));
+  return out;
+}
+
+// mostly follows live edges, sometimes takes a random byte to cover the
+// dead ends as well
+static std::string random_walk(const Dfa& dfa, size_t len) {
+  std::mt19937 rng(0);
+  std::string sample;
+  sample.reserve(len);
+  u32 cur = 0;
+  while (sample.size() < len) {
+    if (dfa.nodes.empty() || std::get<1>(dfa.nodes[cur]).empty() ||
+        rng() % 16 == 0) {
+      sample.push_back((char)rng());
+      cur = 0;
+      continue;
+    }
+    const auto& next = std::get<1>(dfa.nodes[cur]);
+    auto it = std::next(next.begin(), rng() % next.size());
+    sample.push_back(it->first);
+    cur = it->second;
+  }
+  return sample;
+}
+
+static CompiledDfa autotune(const Dfa& dfa, std::string_view sample) {
+  constexpr size_t SAMPLE_LEN = 1 << 16;
+  constexpr int ROUNDS = 3;
+
+  std::string synthetic;
+  if (sample.empty()) {
+    synthetic = random_walk(dfa, SAMPLE_LEN);
+    sample = synthetic;
+  }
+
+  // every layout but kAuto and kStride2, whose table is the square of the
+  // dense one; kShuffle only where it does not fall back
+  std::vector<CompiledDfa> candidates;
+  for (auto layout : {Layout::kDense, Layout::kComb, Layout::kSparse,
+                      Layout::kShuffle}) {
+    if (layout == Layout::kShuffle &&
+        dfa.nodes.size() + 1 > ShuffleTable::MAX_STATES) {
+      continue;
+    }
+    candidates.push_back(CompiledDfa::from_dfa(dfa, layout));
+  }
+
+  // each layout runs its own accept(), accelerated and simd paths included
+  auto inputs = pieces(dfa, sample);
+  size_t best = 0;
+  auto best_time = std::chrono::steady_clock::duration::max();
+  volatile u64 sink = 0;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    auto time = std::chrono::steady_clock::duration::max();
+    for (int round = 0; round < ROUNDS; ++round) {
+      auto begin = std::chrono::steady_clock::now();
+      u64 checksum = 0;
+      for (auto input : inputs) {
+        checksum += candidates[i].accept(input).value_or(0);
+      }
+      sink = sink + checksum;
+      time = std::min(time, std::chrono::steady_clock::now() - begin);
+    }
+    if (time < best_time) {
+      best = i;
+      best_time = time;
+    }
+  }
+  return std::move(candidates[best]);
+}
+
+CompiledDfa CompiledDfa::from_dfa(const Dfa& dfa, Layout layout,
+                                  std::string_view sample) {
+  switch (layout) {
+    case Layout::kDense: {
+      // one extra row for the dead state
+      size_t state_num = dfa.nodes.size() + 1;
+      if (state_num <= (size_t)std::numeric_limits<u8>::max() + 1) {
+        return CompiledDfa(DenseTable<u8>::from_dfa(dfa));
+      }
+      if (state_num <= (size_t)std::numeric_limits<u16>::max() + 1) {
+        return CompiledDfa(DenseTable<u16>::from_dfa(dfa));
+      }
+      return CompiledDfa(DenseTable<u32>::from_dfa(dfa));
+    }
+    case Layout::kComb:
+      return CompiledDfa(CombTable::from_dfa(dfa));
+    case Layout::kSparse:
+      return CompiledDfa(SparseTable::from_dfa(dfa));
+    case Layout::kAuto:
+      return autotune(dfa, sample);
+    case Layout::kStride2:
+      return CompiledDfa(Stride2Table::from_dfa(dfa));
+    case Layout::kShuffle:
+      // one extra state for the dead state
+      if (dfa.nodes.size() + 1 > ShuffleTable::MAX_STATES) {
+        return from_dfa(dfa, Layout::kDense);
+      }
+      return CompiledDfa(ShuffleTable::from_dfa(dfa));
+  }
+  UNREACHABLE();
+}
+
+}  // namespace parsergen::dfa
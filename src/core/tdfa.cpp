@@ -0,0 +1,249 @@
+#include "core/tdfa.h"
+
+#include <algorithm>
+
+namespace parsergen::dfa {
+
+// an nfa state reached on some path, and where each of its registers is
+// read from at this step
+struct TaggedItem {
+  u32 state;
+  std::vector<u32> src;
+};
+
+struct TaggedStateHash {
+  size_t operator()(const std::vector<u32>& s) const {
+    size_t h = s.size();
+    for (auto q : s) h = h * 31 + q;
+    return h;
+  }
+};
+
+// Orders the parallel copies of one transition so that they can run in
+// place: a register is only overwritten once nothing reads it anymore, and
+// a cycle of copies is broken through the spare register tmp. Copies of a
+// register to itself vanish.
+static void sequentialize(std::vector<std::pair<u32, u32>>& copies,
+                          u32 tmp, u32 reg_limit,
+                          std::vector<std::pair<u32, u32>>& out) {
+  copies.erase(std::remove_if(copies.begin(), copies.end(),
+                              [](auto& op) { return op.first == op.second; }),
+               copies.end());
+  // how many pending copies read each register
+  std::vector<u32> readers(reg_limit + 1, 0);
+  for (auto [dst, src] : copies) {
+    if (src < reg_limit) ++readers[src];
+  }
+  while (!copies.empty()) {
+    bool progress = false;
+    for (size_t i = 0; i < copies.size();) {
+      auto [dst, src] = copies[i];
+      if (readers[dst] > 0) {
+        ++i;
+        continue;
+      }
+      out.emplace_back(dst, src);
+      if (src < reg_limit) --readers[src];
+      copies[i] = copies.back();
+      copies.pop_back();
+      progress = true;
+    }
+    if (progress) continue;
+    // only cycles are left, save one destination and read it from tmp
+    u32 saved = copies[0].first;
+    out.emplace_back(tmp, saved);
+    for (auto& op : copies) {
+      if (op.second == saved) {
+        op.second = tmp;
+        --readers[saved];
+      }
+    }
+  }
+}
+
+std::optional<TaggedDfa> TaggedDfa::from_nfa(const nfa::Nfa& nfa, u32 groups,
+                                             u32 max_states) {
+  u32 tags = 2 * groups;
+  TaggedDfa tdfa(tags, nfa.classes);
+  u32 num = nfa.classes.num;
+  auto reps = nfa.classes.representatives();
+  // registers belong to the nfa states that can be items, not to the
+  // position of an item in a state: an item that stays in its nfa state
+  // keeps its registers without a copy
+  std::vector<u32> regs_of(nfa.nodes.size(), 0);
+  for (u32 q = 0; q < (u32)nfa.nodes.size(); ++q) {
+    if (!nfa.nodes[q].edges.empty() || nfa.nodes[q].terminal_id) {
+      regs_of[q] = tdfa.reg_num;
+      tdfa.reg_num += tags;
+    }
+  }
+
+  // every item in priority order, only the ones reading a byte or ending a
+  // match. Popping in reverse push order visits like a recursive dfs would.
+  std::vector<u32> mark(nfa.nodes.size(), 0);
+  u32 epoch = 0;
+  auto closure = [&](std::vector<TaggedItem>&& kernel) {
+    ++epoch;
+    std::vector<TaggedItem> items;
+    std::vector<TaggedItem> stack;
+    for (auto& item : kernel) {
+      stack.push_back(std::move(item));
+      while (!stack.empty()) {
+        auto [q, src] = std::move(stack.back());
+        stack.pop_back();
+        if (mark[q] == epoch) continue;
+        mark[q] = epoch;
+        auto& node = nfa.nodes[q];
+        if (node.tag && *node.tag >= 2 && *node.tag - 2 < tags) {
+          src[*node.tag - 2] = POS;
+        }
+        for (auto it = node.eps_edges.rbegin(); it != node.eps_edges.rend();
+             ++it) {
+          if (mark[*it] != epoch) stack.push_back({*it, src});
+        }
+        if (!node.edges.empty() || node.terminal_id) {
+          items.push_back({q, std::move(src)});
+        }
+      }
+    }
+    return items;
+  };
+
+  std::vector<std::vector<u32>> states;
+  std::unordered_map<std::vector<u32>, u32, TaggedStateHash> ids;
+  // the index of the state of items and the ops filling its registers
+  auto add_state = [&](const std::vector<TaggedItem>& items,
+                       std::vector<Op>& ops) -> std::optional<u32> {
+    std::vector<u32> key;
+    for (auto& item : items) key.push_back(item.state);
+    auto [it, inserted] = ids.emplace(key, (u32)states.size());
+    if (inserted) {
+      if (states.size() >= max_states) return std::nullopt;
+      std::optional<u32> terminal;
+      u32 base = 0;
+      for (u32 j = 0; j < (u32)items.size(); ++j) {
+        auto id = nfa.nodes[items[j].state].terminal_id;
+        if (id && (!terminal || *id < *terminal)) {
+          terminal = id;
+          base = regs_of[items[j].state];
+        }
+      }
+      states.push_back(std::move(key));
+      tdfa.terminals.push_back(terminal);
+      tdfa.final_base.push_back(base);
+    }
+    for (auto& item : items) {
+      for (u32 t = 0; t < tags; ++t) {
+        ops.push_back(Op{regs_of[item.state] + t, item.src[t]});
+      }
+    }
+    return it->second;
+  };
+
+  std::vector<Op> unused;
+  add_state({}, unused);
+  auto start_items = closure({TaggedItem{0, std::vector<u32>(tags, UNSET)}});
+  if (!add_state(start_items, tdfa.start_ops)) return std::nullopt;
+
+  // states are numbered in discovery order, rows are filled in that order
+  for (u32 s = 0; s < (u32)states.size(); ++s) {
+    for (u32 k = 0; k < num; ++k) {
+      tdfa.op_begin.push_back(tdfa.ops.size());
+      std::vector<TaggedItem> kernel;
+      for (auto q : states[s]) {
+        auto& edges = nfa.nodes[q].edges;
+        auto it = edges.find(reps[k]);
+        if (it == edges.end()) continue;
+        std::vector<u32> src(tags);
+        for (u32 t = 0; t < tags; ++t) src[t] = regs_of[q] + t;
+        for (auto target : it->second) kernel.push_back({target, src});
+      }
+      auto items = closure(std::move(kernel));
+      if (items.empty()) {
+        tdfa.trans.push_back(DEAD_STATE);
+        continue;
+      }
+      auto next = add_state(items, tdfa.ops);
+      if (!next) return std::nullopt;
+      tdfa.trans.push_back(*next);
+    }
+  }
+  tdfa.op_begin.push_back(tdfa.ops.size());
+
+  // the ops above are parallel assignments, run them in place with one
+  // spare register after the others
+  std::vector<Op> ops;
+  std::vector<std::pair<u32, u32>> copies, ordered;
+  for (size_t e = 0; e + 1 < tdfa.op_begin.size(); ++e) {
+    copies.clear();
+    ordered.clear();
+    for (u32 i = tdfa.op_begin[e]; i < tdfa.op_begin[e + 1]; ++i) {
+      copies.emplace_back(tdfa.ops[i].dst, tdfa.ops[i].src);
+    }
+    sequentialize(copies, tdfa.reg_num, tdfa.reg_num, ordered);
+    tdfa.op_begin[e] = ops.size();
+    for (auto [dst, src] : ordered) ops.push_back(Op{dst, src});
+  }
+  tdfa.op_begin.back() = ops.size();
+  tdfa.ops = std::move(ops);
+  ++tdfa.reg_num;
+  return tdfa;
+}
+
+std::optional<u32> TaggedDfa::match(std::string_view sv,
+                                    std::vector<Span>& spans) const {
+  std::vector<size_t> regs;
+  return match(sv, spans, regs);
+}
+
+std::optional<u32> TaggedDfa::match(std::string_view sv,
+                                    std::vector<Span>& spans,
+                                    std::vector<size_t>& regs) const {
+  constexpr size_t npos = std::string_view::npos;
+  // every register is written before it is read, old values do no harm
+  if (regs.size() < reg_num) regs.resize(reg_num);
+  auto apply = [&](const Op* first, const Op* last, size_t pos) {
+    for (auto op = first; op != last; ++op) {
+      regs[op->dst] =
+          op->src == POS ? pos : op->src == UNSET ? npos : regs[op->src];
+    }
+  };
+
+  apply(start_ops.data(), start_ops.data() + start_ops.size(), 0);
+  u32 cur = START_STATE;
+  for (size_t i = 0; i < sv.size(); ++i) {
+    u32 e = cur * classes.num + classes.map[(u8)sv[i]];
+    cur = trans[e];
+    if (cur == DEAD_STATE) return std::nullopt;
+    apply(ops.data() + op_begin[e], ops.data() + op_begin[e + 1], i + 1);
+  }
+  if (!terminals[cur]) return std::nullopt;
+
+  spans.assign(group_num() + 1, Span{npos, npos});
+  spans[0] = Span{0, sv.size()};
+  for (u32 k = 1; k <= group_num(); ++k) {
+    size_t begin = regs[final_base[cur] + 2 * (k - 1)];
+    size_t end = regs[final_base[cur] + 2 * (k - 1) + 1];
+    if (begin != npos && end != npos) spans[k] = Span{begin, end};
+  }
+  return terminals[cur];
+}
+
+std::optional<TaggedDfa> TaggedDfa::from_re(std::unique_ptr<re::Re> re,
+                                            u32 id) {
+  u32 groups = re::group_num(*re);
+  return from_nfa(nfa::Nfa::from_re(std::move(re), id), groups);
+}
+
+std::optional<TaggedDfa> TaggedDfa::from_re(
+    std::vector<std::unique_ptr<re::Re>>&& res) {
+  u32 groups = 0;
+  for (auto& re : res) groups = std::max(groups, re::group_num(*re));
+  return from_nfa(nfa::Nfa::from_re(std::move(res)), groups);
+}
+
+std::optional<TaggedDfa> TaggedDfa::from_sv(std::string_view sv, u32 id) {
+  return from_re(re::Re::parse(sv), id);
+}
+
+}  // namespace parsergen::dfa
@@ -51,6 +51,13 @@ std::string dot_from_re(std::unique_ptr<re::Re> regex) {
         stack.push_back(son.get());
         out << top_idx << " -> " << idx_map.at(son.get()) << "\n";
       }
+    } else if (auto c = dyn_cast<re::Group>(top)) {
+      std::string label = "Group " + std::to_string(c->index);
+      out << top_idx << " [ shape = circle, label = \"" << label << "\" ]\n";
+      assert(idx_map.find(c->son.get()) == idx_map.end());
+      idx_map[c->son.get()] = idx++;
+      stack.push_back(c->son.get());
+      out << top_idx << " -> " << idx_map.at(c->son.get()) << "\n";
     } else if (auto c = dyn_cast<re::Disjunction>(top)) {
       std::string label = "Disjunction";
       out << top_idx << " [ shape = circle, label = \"" << label << "\" ]\n";
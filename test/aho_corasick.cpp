@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+//#define DBG_MACRO_DISABLE
+#include "core/aho_corasick.h"
+#include "core/re.h"
+#include "core/search.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+
+TEST(aho_corasick, detect) {
+  EXPECT_TRUE(AhoCorasick::from_re(parse_all({"if", "else", R"(\+=)"})));
+  EXPECT_FALSE(AhoCorasick::from_re(parse_all({"if", "[a-z]+"})));
+  EXPECT_FALSE(AhoCorasick::from_re(parse_all({"if", "el?se"})));
+}
+
+TEST(aho_corasick, accept) {
+  auto ac = AhoCorasick::from_literals({"he", "she", "his", "hers", "he"});
+  EXPECT_EQ(ac.accept("he"), 0);
+  EXPECT_EQ(ac.accept("she"), 1);
+  EXPECT_EQ(ac.accept("hers"), 3);
+  EXPECT_FALSE(ac.accept("her"));
+  EXPECT_FALSE(ac.accept("h"));
+  EXPECT_FALSE(ac.accept(""));
+  EXPECT_FALSE(ac.accept("shee"));
+}
+
+TEST(aho_corasick, overlapping) {
+  auto ac = AhoCorasick::from_literals({"he", "she", "his", "hers"});
+  std::vector<std::tuple<u32, size_t, size_t>> got;
+  ac.for_each_match("ushers", [&got](const Match& m) {
+    got.emplace_back(m.id, m.begin, m.end);
+  });
+  std::vector<std::tuple<u32, size_t, size_t>> expected = {
+      {1, 1, 4}, {0, 2, 4}, {3, 2, 6}};
+  EXPECT_EQ(got, expected);
+}
+
+TEST(aho_corasick, same_as_searcher) {
+  srand(5);
+  for (int round = 0; round < 20; ++round) {
+    std::vector<std::string> words;
+    for (int i = 0; i < 6; ++i) {
+      words.push_back(random_string("abc", 1 + rand() % 4));
+    }
+    std::vector<std::string_view> views(words.begin(), words.end());
+    auto ac = AhoCorasick::from_literals(views);
+    auto searcher = *Searcher::from_re(parse_all(views));
+    for (int i = 0; i < 100; ++i) {
+      auto s = random_string("abcd", rand() % 40);
+      auto matches = ac.find_all(s);
+      auto expected = searcher.find_all(s);
+      ASSERT_EQ(matches.size(), expected.size()) << s;
+      for (size_t j = 0; j < matches.size(); ++j) {
+        EXPECT_EQ(matches[j].id, expected[j].id) << s;
+        EXPECT_EQ(matches[j].begin, expected[j].begin) << s;
+        EXPECT_EQ(matches[j].end, expected[j].end) << s;
+      }
+      size_t count = 0;
+      ac.for_each_match(s, [&](const Match& m) {
+        EXPECT_EQ(ac.accept(s.substr(m.begin, m.end - m.begin)), m.id);
+        ++count;
+      });
+      size_t naive = 0;
+      for (size_t b = 0; b < s.size(); ++b) {
+        for (size_t e = b + 1; e <= s.size(); ++e) {
+          naive += ac.accept(s.substr(b, e - b)).has_value();
+        }
+      }
+      EXPECT_EQ(count, naive) << s;
+    }
+  }
+}
+
+TEST(aho_corasick, many_keywords) {
+  srand(3);
+  std::vector<std::string> words;
+  std::unordered_map<std::string, u32> first_id;
+  const char* alphabet = "abcdefghijklmnopqrstuvwxyz_";
+  for (u32 i = 0; i < 100000; ++i) {
+    words.push_back(random_string(alphabet, 3 + rand() % 10));
+    first_id.emplace(words.back(), i);
+  }
+  auto begin = std::chrono::steady_clock::now();
+  auto ac = AhoCorasick::from_literals(
+      std::vector<std::string_view>(words.begin(), words.end()));
+  auto seconds = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count();
+  EXPECT_LT(seconds, 10);
+  for (auto& [word, id] : first_id) ASSERT_EQ(ac.accept(word), id);
+  for (int i = 0; i < 1000; ++i) {
+    auto s = random_string(alphabet, 3 + rand() % 10);
+    auto it = first_id.find(s);
+    EXPECT_EQ(ac.accept(s), it == first_id.end()
+                                ? std::nullopt
+                                : std::make_optional(it->second));
+  }
+}
+
+TEST(aho_corasick, searcher_detects_literals) {
+  std::vector<std::string> words;
+  for (int i = 0; i < 5000; ++i) words.push_back("kw" + std::to_string(i));
+  std::vector<std::string_view> views(words.begin(), words.end());
+  // far over the nodes a dfa takes, only fine as a trie
+  auto searcher = Searcher::from_re(parse_all(views));
+  ASSERT_TRUE(searcher);
+  EXPECT_TRUE(searcher->is_literal());
+  auto matches = searcher->find_all("x kw12 kw4999 kw5000");
+  ASSERT_EQ(matches.size(), 3);
+  EXPECT_EQ(matches[0].id, 12);
+  EXPECT_EQ(matches[1].id, 4999);
+  EXPECT_EQ(matches[2].id, 500);
+  EXPECT_EQ(searcher->count("kw1kw2"), 2);
+  EXPECT_FALSE(Searcher::from_sv("kw[0-9]")->is_literal());
+}
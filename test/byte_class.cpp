@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/byte_class.h"
+#include "core/dfa.h"
+#include "core/nfa.h"
+#include "core/re.h"
+
+using namespace parsergen;
+
+TEST(refine, single_class) {
+  ByteClasses classes;
+  EXPECT_EQ(classes.num, 1);
+  EXPECT_EQ(classes.representatives(), std::vector<u8>{0});
+  EXPECT_EQ(classes.members()[0].size(), 256);
+}
+
+TEST(refine, split) {
+  ByteClasses classes;
+  std::array<u32, 256> key;
+  key.fill(0);
+  for (int c = 'a'; c <= 'z'; ++c) key[c] = 1;
+  classes.refine(key);
+  EXPECT_EQ(classes.num, 2);
+  key.fill(0);
+  key['x'] = 1;
+  classes.refine(key);
+  EXPECT_EQ(classes.num, 3);
+  EXPECT_EQ(classes.map['a'], classes.map['z']);
+  EXPECT_NE(classes.map['a'], classes.map['x']);
+  EXPECT_EQ(classes.representatives(), (std::vector<u8>{0, 'a', 'x'}));
+}
+
+TEST(from_re, char_set) {
+  auto re = re::Re::parse(R"(\d+|(0x[0-9a-fA-F]+))");
+  auto classes = ByteClasses::from_re(*re);
+  EXPECT_EQ(classes.num, 5);
+  auto ident = ByteClasses::from_re(*re::Re::parse(R"([_A-Za-z]\w*)"));
+  // [_A-Za-z], [0-9] and the rest
+  EXPECT_EQ(ident.num, 3);
+}
+
+TEST(from_re, merged_rules) {
+  std::vector<std::unique_ptr<re::Re>> res;
+  res.push_back(re::Re::parse(R"(\d+)"));
+  res.push_back(re::Re::parse(R"([a-z]+)"));
+  res.push_back(re::Re::parse(R"(if)"));
+  auto nfa = nfa::Nfa::from_re(std::move(res));
+  // [0-9], 'i', 'f', the other lowercase letters and the rest
+  EXPECT_EQ(nfa.classes.num, 5);
+
+  auto dfa = dfa::Dfa::from_nfa(std::move(nfa));
+  EXPECT_EQ(dfa.accept("123"), 0);
+  EXPECT_EQ(dfa.accept("if"), 1);
+  EXPECT_EQ(dfa.accept("iff"), 1);
+  EXPECT_EQ(dfa.accept("abc"), 1);
+}
+
+TEST(from_dfa, coarsest) {
+  auto dfa = dfa::Dfa::from_sv(R"(a[bc]|d[bc])");
+  // 'a' and 'd' lead to the same minimized state
+  EXPECT_EQ(dfa.classes.num, 3);
+  EXPECT_EQ(dfa.classes.map['a'], dfa.classes.map['d']);
+  EXPECT_EQ(dfa.classes.map['b'], dfa.classes.map['c']);
+}
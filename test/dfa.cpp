@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <string>
 #include <string_view>
 #include <unordered_set>
 
@@ -109,3 +110,24 @@ TEST(real_case, ident) {
   EXPECT_TRUE(dfa.accept("a1"));
   EXPECT_FALSE(dfa.accept("1a"));
 }
+
+TEST(budget, try_from_nfa) {
+  std::string pattern = "[ab]*a";
+  for (int i = 0; i < 4; ++i) pattern += "[ab]";
+  auto nfa = parsergen::nfa::Nfa::from_sv(pattern);
+  // 2^5 subsets of the last five positions
+  EXPECT_FALSE(Dfa::try_from_nfa(nfa, 16));
+  auto dfa = Dfa::try_from_nfa(nfa, 64);
+  ASSERT_TRUE(dfa);
+  EXPECT_TRUE(dfa->accept("babbbb"));
+  EXPECT_FALSE(dfa->accept("bbbbb"));
+}
+
+TEST(minimize, loop_back_to_start) {
+  // the merged start state is only reached again through a back edge
+  auto dfa = Dfa::from_sv("(ab)*c");
+  EXPECT_TRUE(dfa.accept("c"));
+  EXPECT_TRUE(dfa.accept("abc"));
+  EXPECT_TRUE(dfa.accept("ababc"));
+  EXPECT_FALSE(dfa.accept("abbc"));
+}
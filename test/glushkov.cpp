@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/dfa.h"
+#include "core/glushkov.h"
+#include "core/nfa.h"
+#include "core/pike_vm.h"
+#include "core/table.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+using parsergen::nfa::Glushkov;
+using parsergen::nfa::PikeVm;
+
+TEST(glushkov, char_set_is_one_position) {
+  auto glushkov = Glushkov::from_sv(R"([_A-Za-z]\w*)");
+  ASSERT_TRUE(glushkov);
+  EXPECT_EQ(glushkov->words(), 1);
+  EXPECT_EQ(glushkov->accept("a1"), 0);
+  EXPECT_FALSE(glushkov->accept("1a"));
+  EXPECT_FALSE(glushkov->accept(""));
+}
+
+TEST(glushkov, empty_and_any) {
+  EXPECT_FALSE(Glushkov::from_sv("(ab"));
+  // each parses to epsilon, which matches only ""
+  for (auto sv : {"", "[]", "a[]"}) {
+    auto glushkov = Glushkov::from_sv(sv);
+    ASSERT_TRUE(glushkov) << sv;
+    EXPECT_EQ(glushkov->accept(sv[0] == 'a' ? "a" : ""), 0) << sv;
+    EXPECT_FALSE(glushkov->accept("b")) << sv;
+  }
+  for (auto sv : {".", "a|."}) {
+    auto glushkov = Glushkov::from_sv(sv);
+    ASSERT_TRUE(glushkov) << sv;
+    EXPECT_EQ(glushkov->accept("b"), 0) << sv;
+    EXPECT_FALSE(glushkov->accept("")) << sv;
+    EXPECT_FALSE(glushkov->accept("ab")) << sv;
+  }
+}
+
+TEST(glushkov, same_as_dfa) {
+  srand(23);
+  for (auto pattern : {"a*b", "ab|b", "[ab]*abb", "aab|a", "abcd|bc|c",
+                       "(ab)*c", "b[ac]*b", "a[bc]*|bc+", "a*", "(a*b?)*c"}) {
+    auto glushkov = Glushkov::from_sv(pattern, 3);
+    ASSERT_TRUE(glushkov);
+    auto dfa = CompiledDfa::from_dfa(Dfa::from_sv(pattern, 3));
+    for (int i = 0; i < 300; ++i) {
+      auto s = random_string("abcx", rand() % 16);
+      ASSERT_EQ(glushkov->accept(s), dfa.accept(s)) << pattern << " " << s;
+      size_t pos = rand() % (s.size() + 1);
+      auto token = glushkov->scan(s, pos);
+      auto expected = dfa.scan(s, pos);
+      ASSERT_EQ(token.has_value(), expected.has_value())
+          << pattern << " " << s;
+      if (token) {
+        EXPECT_EQ(token->id, expected->id);
+        EXPECT_EQ(token->len, expected->len) << pattern << " " << s;
+      }
+    }
+  }
+}
+
+TEST(glushkov, rule_ids) {
+  std::vector<std::string> rules = {"if", "[a-z]+", R"(\d+)", R"(\s+)"};
+  auto glushkov = Glushkov::from_re(parse_all(rules));
+  ASSERT_TRUE(glushkov);
+  auto dfa = CompiledDfa::from_dfa(
+      Dfa::from_nfa(nfa::Nfa::from_re(parse_all(rules))));
+  for (int i = 0; i < 1000; ++i) {
+    auto s = random_string("if x1 ", rand() % 8);
+    ASSERT_EQ(glushkov->accept(s), dfa.accept(s)) << s;
+  }
+}
+
+TEST(glushkov, wide_masks) {
+  // a few hundred positions, checked against the pike vm
+  std::vector<std::string> rules;
+  for (int i = 0; i < 60; ++i) rules.push_back("k" + std::to_string(i * 13));
+  rules.push_back("[ab]*a[ab][ab][ab][ab][ab][ab][ab][ab][ab][ab][ab][ab]");
+  auto glushkov = Glushkov::from_re(parse_all(rules));
+  ASSERT_TRUE(glushkov);
+  EXPECT_EQ(glushkov->words(), 4);
+  auto vm = PikeVm::from_re(parse_all(rules));
+  srand(5);
+  for (int i = 0; i < 1000; ++i) {
+    auto s = i % 2 ? random_string("ab", rand() % 30)
+                   : "k" + std::to_string(rand() % 800);
+    ASSERT_EQ(glushkov->accept(s), vm.accept(s)) << s;
+  }
+}
+
+TEST(glushkov, too_many_positions) {
+  std::string pattern;
+  for (int i = 0; i < 600; ++i) pattern += "a";
+  EXPECT_FALSE(Glushkov::from_sv(pattern));
+  pattern.resize(500);
+  auto glushkov = Glushkov::from_sv(pattern);
+  ASSERT_TRUE(glushkov);
+  EXPECT_EQ(glushkov->words(), 8);
+  EXPECT_TRUE(glushkov->accept(pattern));
+  EXPECT_FALSE(glushkov->accept(pattern + "a"));
+}
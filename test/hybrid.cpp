@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/hybrid.h"
+#include "core/nfa.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+
+TEST(hybrid, small_is_dfa) {
+  auto hybrid = *Hybrid::from_sv(R"([_A-Za-z]\w*)");
+  EXPECT_TRUE(hybrid.is_dfa());
+  EXPECT_TRUE(hybrid.accept("a1"));
+  EXPECT_FALSE(hybrid.accept("1a"));
+}
+
+TEST(hybrid, bad_pattern) {
+  // reported, not a process exit
+  EXPECT_FALSE(Hybrid::from_sv("(ab"));
+  EXPECT_FALSE(Hybrid::from_sv("a)"));
+  EXPECT_FALSE(Hybrid::from_sv("*a"));
+  EXPECT_TRUE(Hybrid::from_sv("(ab)"));
+}
+
+TEST(hybrid, empty_and_any) {
+  auto any = Hybrid::from_sv(".");
+  ASSERT_TRUE(any);
+  EXPECT_TRUE(any->accept("x"));
+  EXPECT_TRUE(any->accept("\n"));
+  EXPECT_FALSE(any->accept(""));
+  EXPECT_FALSE(any->accept("xy"));
+  // each parses to epsilon, which matches only ""
+  for (auto sv : {"", "[]", "|"}) {
+    auto empty = Hybrid::from_sv(sv);
+    ASSERT_TRUE(empty) << sv;
+    EXPECT_TRUE(empty->accept("")) << sv;
+    EXPECT_FALSE(empty->accept("a")) << sv;
+  }
+  auto a_or_any = Hybrid::from_sv("a|.");
+  ASSERT_TRUE(a_or_any);
+  EXPECT_TRUE(a_or_any->accept("a"));
+  EXPECT_TRUE(a_or_any->accept("b"));
+  EXPECT_FALSE(a_or_any->accept("ab"));
+  // a set with no chars accepts nothing
+  auto none = Hybrid::from_re(std::make_unique<re::Disjunction>());
+  EXPECT_FALSE(none.accept(""));
+  EXPECT_FALSE(none.accept("a"));
+}
+
+TEST(hybrid, too_many_states) {
+  // 2^13 dfa states, far over the default budget
+  std::string pattern = "[ab]*a";
+  for (int i = 0; i < 12; ++i) pattern += "[ab]";
+  auto hybrid = *Hybrid::from_sv(pattern, 0, Budget{Dfa::MAX_STATES, 4096});
+  EXPECT_FALSE(hybrid.is_dfa());
+  for (int i = 0; i < 500; ++i) {
+    auto s = random_string("ab", rand() % 40);
+    bool expected = s.size() >= 13 && s[s.size() - 13] == 'a';
+    ASSERT_EQ(hybrid.accept(s).has_value(), expected) << s;
+    ASSERT_LE(hybrid.memory(), 4096u);
+  }
+}
+
+TEST(hybrid, too_many_nfa_states) {
+  std::vector<std::unique_ptr<re::Re>> res;
+  for (int i = 0; i < 400; ++i) {
+    res.push_back(re::Re::parse("kw" + std::to_string(i * 7)));
+  }
+  auto hybrid = Hybrid::from_re(std::move(res));
+  EXPECT_FALSE(hybrid.is_dfa());
+  EXPECT_EQ(hybrid.accept("kw280"), 40u);
+  EXPECT_FALSE(hybrid.accept("kw281"));
+  auto token = hybrid.scan("x kw14 ", 2);
+  ASSERT_TRUE(token);
+  EXPECT_EQ(token->id, 2u);
+  EXPECT_EQ(token->len, 4u);
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/dfa.h"
+#include "core/lazy_dfa.h"
+#include "core/nfa.h"
+#include "core/table.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+
+TEST(lazy, same_as_dfa) {
+  std::vector<const char*> rules = {"if", R"([_A-Za-z]\w*)", R"(\d+)",
+                                    R"(0x[0-9a-f]+)", R"(\s+)"};
+  auto table = CompiledDfa::from_dfa(
+      Dfa::from_nfa(nfa::Nfa::from_re(parse_all(rules))));
+  auto lazy = LazyDfa::from_re(parse_all(rules));
+  for (int i = 0; i < 2000; ++i) {
+    auto s = random_string("if x0_9 ", rand() % 12);
+    ASSERT_EQ(lazy.accept(s), table.accept(s)) << s;
+    auto expected = table.scan(s);
+    auto token = lazy.scan(s);
+    ASSERT_EQ(token.has_value(), expected.has_value()) << s;
+    if (token) {
+      EXPECT_EQ(token->id, expected->id) << s;
+      EXPECT_EQ(token->len, expected->len) << s;
+    }
+  }
+}
+
+TEST(lazy, tiny_cache) {
+  // the dfa has a state per suffix of 12 bytes, the cache holds a handful
+  std::string pattern = "[ab]*a";
+  for (int i = 0; i < 11; ++i) pattern += "[ab]";
+  auto lazy = LazyDfa::from_sv(pattern, 0, 1024);
+  auto expected = [](const std::string& s) {
+    return s.size() >= 12 && s[s.size() - 12] == 'a';
+  };
+  for (int i = 0; i < 500; ++i) {
+    auto s = random_string("ab", rand() % 40);
+    ASSERT_EQ(lazy.accept(s).has_value(), expected(s)) << s;
+    ASSERT_LE(lazy.memory(), 1024u);
+  }
+  EXPECT_GT(lazy.flushes(), 0u);
+}
+
+TEST(lazy, huge_nfa) {
+  // too many nfa states for the eager subset construction
+  std::vector<std::string> words;
+  for (int i = 0; i < 400; ++i) words.push_back("kw" + std::to_string(i * 7));
+  std::vector<std::unique_ptr<re::Re>> res;
+  for (auto& word : words) res.push_back(re::Re::parse(word));
+  auto nfa = nfa::Nfa::from_re(std::move(res));
+  ASSERT_GT(nfa.nodes.size(), 1024u);
+  auto lazy = LazyDfa::from_nfa(std::move(nfa));
+  for (u32 i = 0; i < (u32)words.size(); ++i) {
+    EXPECT_EQ(lazy.accept(words[i]), i) << words[i];
+  }
+  EXPECT_FALSE(lazy.accept("kw1"));
+  EXPECT_FALSE(lazy.accept("kw"));
+  auto token = lazy.scan("kw2800x", 0);
+  ASSERT_TRUE(token);
+  EXPECT_EQ(token->id, 40u);
+  EXPECT_EQ(token->len, 5u);
+}
+
+TEST(lazy, token_rules_after_flush) {
+  // every new state flushes, the token's label must survive the scan
+  auto lazy = LazyDfa::from_nfa_sets(
+      nfa::Nfa::from_re(parse_all({"a", "ab*c", "xyz"})), 1);
+  EXPECT_TRUE(lazy.accept("xyz"));
+  auto token = lazy.scan("abbbbbbbd");
+  ASSERT_TRUE(token);
+  EXPECT_EQ(token->len, 1u);
+  EXPECT_GT(lazy.flushes(), 0u);
+  EXPECT_EQ(lazy.rules(token->id), (std::vector<u32>{0}));
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <string>
 #include <string_view>
 #include <unordered_set>
 
@@ -89,3 +91,39 @@ TEST(real_case, ident) {
   EXPECT_TRUE(dfa.accept("a1"));
   EXPECT_FALSE(dfa.accept("1a"));
 }
+
+TEST(reverse, accepts_reversed) {
+  auto nfa = Nfa::from_sv(R"([1-9][0-9]*\.[0-9]+x|ab*c)");
+  auto forward = Dfa::from_nfa(Nfa(nfa));
+  auto backward = Dfa::from_nfa(nfa.reverse(7));
+  for (auto s : {"12.5x", "1.0x", "ac", "abbbc", "01.5x", "ab", "12.x"}) {
+    std::string r(s);
+    std::reverse(r.begin(), r.end());
+    EXPECT_EQ(forward.accept(s).has_value(), backward.accept(r).has_value())
+        << s;
+    if (forward.accept(s)) {
+      EXPECT_EQ(backward.accept(r), 7);
+    }
+  }
+}
+
+TEST(char_set, one_node) {
+  // an entry with one edge per byte and the exit, however many chars
+  auto nfa = Nfa::from_sv("[0-9a-z]");
+  ASSERT_EQ(nfa.nodes.size(), 2);
+  EXPECT_EQ(nfa.nodes[0].edges.size(), 36);
+  for (auto& [c, targets] : nfa.nodes[0].edges) {
+    EXPECT_EQ(targets, std::vector<parsergen::u32>{1}) << (int)c;
+  }
+  EXPECT_TRUE(nfa.nodes[1].terminal_id);
+  // a loop over a set stays one reading node
+  auto loop = Nfa::from_sv("x[ab]*y");
+  size_t reading = std::count_if(
+      loop.nodes.begin(), loop.nodes.end(),
+      [](const NfaNode& node) { return !node.edges.empty(); });
+  EXPECT_EQ(reading, 3);
+  auto dfa = Dfa::from_nfa(std::move(loop));
+  EXPECT_TRUE(dfa.accept("xabbay"));
+  EXPECT_TRUE(dfa.accept("xy"));
+  EXPECT_FALSE(dfa.accept("xacy"));
+}
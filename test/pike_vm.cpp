@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/dfa.h"
+#include "core/nfa.h"
+#include "core/pike_vm.h"
+#include "core/search.h"
+#include "core/table.h"
+#include "core/tdfa.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+using parsergen::nfa::PikeVm;
+
+TEST(pike_vm, find) {
+  auto vm = PikeVm::from_sv("abcd|c");
+  auto match = vm.find("xabcd");
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->begin, 1);
+  EXPECT_EQ(match->end, 5);
+  match = vm.find("xabcx");
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->begin, 3);
+  EXPECT_EQ(match->end, 4);
+  EXPECT_FALSE(vm.find("xabx"));
+}
+
+TEST(pike_vm, rule_id) {
+  std::vector<std::unique_ptr<re::Re>> res;
+  res.push_back(re::Re::parse("if"));
+  res.push_back(re::Re::parse("[a-z]+"));
+  auto vm = PikeVm::from_re(std::move(res));
+  EXPECT_EQ(vm.accept("if"), 0);
+  EXPECT_EQ(vm.accept("iff"), 1);
+  auto matches = vm.find_all("1 if 2 iff");
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches[0].id, 0);
+  EXPECT_EQ(matches[1].id, 1);
+  EXPECT_EQ(matches[1].begin, 7);
+  EXPECT_EQ(matches[1].end, 10);
+}
+
+TEST(pike_vm, same_as_dfa) {
+  srand(22);
+  for (auto pattern : {"a*b", "ab|b", "[ab]*abb", "aab|a", "abcd|bc|c",
+                       "(ab)*c", "b[ac]*b", "a[bc]*|bc+", "a*"}) {
+    auto vm = PikeVm::from_sv(pattern);
+    auto searcher = *Searcher::from_sv(pattern);
+    auto anchored = CompiledDfa::from_dfa(Dfa::from_sv(pattern));
+    for (int i = 0; i < 300; ++i) {
+      auto s = random_string("abcx", rand() % 24);
+      ASSERT_EQ(vm.accept(s), anchored.accept(s)) << pattern << " " << s;
+      auto token = vm.scan(s, 1 % (s.size() + 1));
+      auto expected_token = anchored.scan(s, 1 % (s.size() + 1));
+      ASSERT_EQ(token.has_value(), expected_token.has_value())
+          << pattern << " " << s;
+      if (token) {
+        EXPECT_EQ(token->len, expected_token->len) << s;
+      }
+
+      auto matches = vm.find_all(s);
+      auto expected = searcher.find_all(s);
+      ASSERT_EQ(matches.size(), expected.size()) << pattern << " " << s;
+      for (size_t j = 0; j < matches.size(); ++j) {
+        EXPECT_EQ(matches[j].begin, expected[j].begin) << pattern << " " << s;
+        EXPECT_EQ(matches[j].end, expected[j].end) << pattern << " " << s;
+      }
+    }
+  }
+}
+
+TEST(pike_vm, captures_same_as_tdfa) {
+  srand(25);
+  for (auto pattern : {"(a*)(b*)", "([ab]*)(b)", "(a+)(a*)b", "(ab)*c",
+                       "([ab]*)([bc]+)", "(a?)(ab)?b", "x(a*)(ab)*(b*)",
+                       "(a)*(b)+", "([abc]*)(c)([abc]*)", "(a)|(b)"}) {
+    auto vm = PikeVm::from_sv(pattern);
+    auto tdfa = TaggedDfa::from_sv(pattern);
+    ASSERT_TRUE(tdfa);
+    EXPECT_EQ(vm.group_num(), tdfa->group_num());
+    std::vector<Span> spans, expected;
+    for (int i = 0; i < 300; ++i) {
+      auto s = random_string("abcx", rand() % 10);
+      auto id = tdfa->match(s, expected);
+      ASSERT_EQ(vm.captures(s, spans), id) << pattern << " " << s;
+      if (!id) continue;
+      ASSERT_EQ(spans.size(), expected.size());
+      for (size_t k = 0; k < spans.size(); ++k) {
+        EXPECT_EQ(spans[k].begin, expected[k].begin)
+            << pattern << " " << s << " " << k;
+        EXPECT_EQ(spans[k].end, expected[k].end)
+            << pattern << " " << s << " " << k;
+      }
+    }
+  }
+}
+
+TEST(pike_vm, captures_rule_ids) {
+  std::vector<std::unique_ptr<re::Re>> res;
+  res.push_back(re::Re::parse("GET (/[a-z]*)"));
+  res.push_back(re::Re::parse("([A-Z]+) (/[a-z/]*)"));
+  auto vm = PikeVm::from_re(std::move(res));
+  std::vector<Span> spans;
+  ASSERT_EQ(vm.captures("GET /index", spans), 0);
+  EXPECT_EQ(spans[1].begin, 4);
+  EXPECT_EQ(spans[1].end, 10);
+  ASSERT_EQ(vm.captures("PUT /a/b", spans), 1);
+  EXPECT_EQ(spans[1].end, 3);
+  EXPECT_EQ(spans[2].begin, 4);
+  EXPECT_FALSE(vm.captures("PUT", spans));
+}
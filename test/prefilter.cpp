@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/nfa.h"
+#include "core/prefilter.h"
+#include "core/re.h"
+#include "core/search.h"
+#include "util.h"
+
+using namespace parsergen;
+
+static std::optional<Prefilter> from_sv(std::string_view sv) {
+  return Prefilter::from_re(*re::Re::parse(sv));
+}
+
+TEST(prefilter, required_literals) {
+  auto hex = from_sv("0x[0-9a-fA-F]+");
+  ASSERT_TRUE(hex);
+  EXPECT_EQ(hex->literals(), std::vector<std::string>{"0x"});
+  EXPECT_EQ(hex->lead(), 0);
+
+  // the longer literal wins even behind an optional byte
+  auto inner = from_sv("ab?cd");
+  ASSERT_TRUE(inner);
+  EXPECT_EQ(inner->literals(), std::vector<std::string>{"cd"});
+  EXPECT_EQ(inner->lead(), 2);
+
+  auto alt = from_sv("foo|bar");
+  ASSERT_TRUE(alt);
+  EXPECT_EQ(alt->literals(), (std::vector<std::string>{"foo", "bar"}));
+
+  auto set = from_sv("[a-c]x*yz");
+  ASSERT_TRUE(set);
+  EXPECT_EQ(set->literals().size(), 3);
+  EXPECT_EQ(set->lead(), 0);
+
+  // some match needs no literal, or too many of them
+  EXPECT_FALSE(from_sv("a*"));
+  EXPECT_FALSE(from_sv("[a-z]+"));
+  EXPECT_FALSE(from_sv("foo|b*"));
+}
+
+TEST(prefilter, rules) {
+  std::vector<std::unique_ptr<re::Re>> res;
+  res.push_back(re::Re::parse("if"));
+  res.push_back(re::Re::parse("x?else"));
+  auto prefilter = Prefilter::from_re(res);
+  ASSERT_TRUE(prefilter);
+  EXPECT_EQ(prefilter->literals(),
+            (std::vector<std::string>{"if", "else"}));
+  EXPECT_EQ(prefilter->lead(), 1);
+  res.push_back(re::Re::parse("[a-z]+"));
+  EXPECT_FALSE(Prefilter::from_re(res));
+}
+
+TEST(prefilter, find) {
+  Prefilter one({"needle"}, 3);
+  std::string hay(100, '.');
+  hay.replace(70, 6, "needle");
+  EXPECT_EQ(one.find(hay, 0), 70);
+  EXPECT_EQ(one.skip(hay, 0), 67);
+  EXPECT_EQ(one.skip(hay, 69), 69);
+  EXPECT_EQ(one.find(hay, 71), std::string_view::npos);
+
+  Prefilter many({"ab", "bc", "cd"}, 0);
+  std::string s = random_string("abcd.", 4096);
+  for (size_t pos = 0; pos < s.size(); pos += 17) {
+    size_t expected = std::string_view::npos;
+    for (size_t i = pos; i + 1 < s.size(); ++i) {
+      auto two = s.substr(i, 2);
+      if (two == "ab" || two == "bc" || two == "cd") {
+        expected = i;
+        break;
+      }
+    }
+    ASSERT_EQ(many.find(s, pos), expected) << pos;
+  }
+}
+
+TEST(prefilter, same_search) {
+  srand(11);
+  for (auto pattern : {"0x[0-9a]+", "ab?cd", "foo|bar", "[a-c]x*yz",
+                       "(ab)?abc", "o?bar"}) {
+    auto searcher = *dfa::Searcher::from_sv(pattern);
+    ASSERT_TRUE(searcher.prefilter()) << pattern;
+    auto plain = *dfa::Searcher::from_nfa(nfa::Nfa::from_sv(pattern));
+    for (int i = 0; i < 300; ++i) {
+      auto s = random_string("0x9abcdforyz.", rand() % 64);
+      auto matches = searcher.find_all(s);
+      auto expected = plain.find_all(s);
+      ASSERT_EQ(matches.size(), expected.size()) << pattern << " " << s;
+      for (size_t j = 0; j < matches.size(); ++j) {
+        EXPECT_EQ(matches[j].begin, expected[j].begin) << pattern << " " << s;
+        EXPECT_EQ(matches[j].end, expected[j].end) << pattern << " " << s;
+      }
+      EXPECT_EQ(searcher.count(s), expected.size());
+    }
+  }
+}
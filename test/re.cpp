@@ -40,3 +40,26 @@ TEST(basic, real_case) {
   EXPECT_NO_THROW({ auto _ = Re::parse(R"([^abc])"); });
   EXPECT_NO_THROW({ auto _ = Re::parse(R"([\w])"); });
 }
+
+TEST(basic, groups) {
+  auto ptr = Re::parse("(ab)c(d)|(e)");
+  EXPECT_EQ(group_num(*ptr), 3);
+  auto dis = static_cast<Disjunction*>(ptr.get());
+  auto concat = static_cast<Concat*>(dis->sons[0].get());
+  ASSERT_TRUE(isa<Group>(concat->sons[0]));
+  EXPECT_EQ(static_cast<Group*>(concat->sons[0].get())->index, 1);
+  ASSERT_TRUE(isa<Group>(concat->sons[2]));
+  EXPECT_EQ(static_cast<Group*>(concat->sons[2].get())->index, 2);
+  auto clone = ptr->clone();
+  EXPECT_EQ(group_num(*clone), 3);
+}
+
+TEST(basic, try_parse) {
+  std::string error;
+  EXPECT_FALSE(Re::try_parse("(ab", &error));
+  EXPECT_NE(error.find("need )"), std::string::npos) << error;
+  for (auto bad : {"a)", "b]", "[a", "+a", "a|*", R"(\q)", R"(a\)", "[(]"}) {
+    EXPECT_FALSE(Re::try_parse(bad)) << bad;
+  }
+  EXPECT_TRUE(Re::try_parse("(ab)c|[a-z]+"));
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/dfa.h"
+#include "core/regex_set.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+
+TEST(regex_set, every_rule) {
+  auto set = *RegexSet::from_sv({"/api/[a-z]*", "/api/users", "/[a-z/]*",
+                                 "/static/[a-z]*[.]js", "[0-9]+"});
+  EXPECT_TRUE(set.is_dfa());
+  EXPECT_EQ(set.matches("/api/users"), (std::vector<u32>{0, 1, 2}));
+  EXPECT_EQ(set.matches("/api/user"), (std::vector<u32>{0, 2}));
+  EXPECT_EQ(set.matches("/static/app.js"), (std::vector<u32>{3}));
+  EXPECT_EQ(set.matches("/static/app"), (std::vector<u32>{2}));
+  EXPECT_EQ(set.matches("42"), (std::vector<u32>{4}));
+  EXPECT_TRUE(set.matches("/api/Users").empty());
+  EXPECT_FALSE(set.is_match(""));
+}
+
+TEST(regex_set, same_as_one_by_one) {
+  std::vector<std::string_view> rules = {"a[ab]*", "[ab]*b", "(ab)*",
+                                         "[ab]a[ab]", "b*"};
+  auto set = *RegexSet::from_sv(rules);
+  std::vector<Dfa> dfas;
+  for (auto rule : rules) dfas.push_back(Dfa::from_sv(rule));
+  for (int i = 0; i < 500; ++i) {
+    auto s = random_string("ab", rand() % 8);
+    std::vector<u32> expected;
+    for (u32 r = 0; r < (u32)dfas.size(); ++r) {
+      if (dfas[r].accept(s)) expected.push_back(r);
+    }
+    ASSERT_EQ(set.matches(s), expected) << s;
+  }
+}
+
+TEST(regex_set, lazy) {
+  // 2^13 dfa states, far over a budget of 16
+  std::string suffix = "[ab]*a";
+  for (int i = 0; i < 12; ++i) suffix += "[ab]";
+  auto set = *RegexSet::from_sv({suffix, "a[ab]*", "[ab]*b"},
+                                Budget{16, LazyDfa::DEFAULT_CACHE_SIZE});
+  EXPECT_FALSE(set.is_dfa());
+  for (int i = 0; i < 500; ++i) {
+    auto s = random_string("ab", rand() % 40);
+    std::vector<u32> expected;
+    if (s.size() >= 13 && s[s.size() - 13] == 'a') expected.push_back(0);
+    if (!s.empty() && s[0] == 'a') expected.push_back(1);
+    if (!s.empty() && s.back() == 'b') expected.push_back(2);
+    ASSERT_EQ(set.matches(s), expected) << s;
+  }
+}
+
+TEST(regex_set, many_rules) {
+  // over the 1024 nfa nodes of the eager construction
+  std::vector<std::unique_ptr<re::Re>> res;
+  for (int i = 0; i < 1000; ++i) {
+    res.push_back(re::Re::parse("id" + std::to_string(i)));
+  }
+  res.push_back(re::Re::parse("id[0-9]*"));
+  auto set = RegexSet::from_re(std::move(res));
+  EXPECT_FALSE(set.is_dfa());
+  EXPECT_EQ(set.matches("id512"), (std::vector<u32>{512, 1000}));
+  EXPECT_EQ(set.matches("id5120"), (std::vector<u32>{1000}));
+  EXPECT_TRUE(set.matches("ib5").empty());
+}
+
+TEST(regex_set, sets_within_budget) {
+  // rule k is an 'a' k bytes before the end, every subset of the rules is
+  // the set of some input: far more sets than the cache holds
+  std::vector<std::string> rules;
+  for (int k = 0; k < 12; ++k) {
+    rules.push_back("[ab]*a");
+    for (int i = 0; i < k; ++i) rules.back() += "[ab]";
+  }
+  auto set = *RegexSet::from_sv({rules.begin(), rules.end()},
+                                Budget{16, 16384});
+  EXPECT_FALSE(set.is_dfa());
+  for (int i = 0; i < 2000; ++i) {
+    auto s = random_string("ab", rand() % 40);
+    std::vector<u32> expected;
+    for (u32 k = 0; k < 12; ++k) {
+      if (s.size() > k && s[s.size() - 1 - k] == 'a') expected.push_back(k);
+    }
+    ASSERT_EQ(set.matches(s), expected) << s;
+    ASSERT_LE(set.memory(), 16384u);
+  }
+}
+
+TEST(regex_set, literals) {
+  auto set = *RegexSet::from_sv({"get", "post", "(get)", "put"});
+  EXPECT_TRUE(set.is_literal());
+  EXPECT_EQ(set.matches("get"), (std::vector<u32>{0, 2}));
+  EXPECT_EQ(set.matches("put"), (std::vector<u32>{3}));
+  EXPECT_TRUE(set.matches("ge").empty());
+  EXPECT_TRUE(set.matches("").empty());
+  EXPECT_FALSE(RegexSet::from_sv({"get", "p[ou]t"})->is_literal());
+}
+
+TEST(regex_set, bad_pattern) {
+  // one malformed rule is reported, not a process exit
+  EXPECT_FALSE(RegexSet::from_sv({"get", "p[ou", "put"}));
+  EXPECT_FALSE(RegexSet::from_sv({"a**)"}));
+  EXPECT_TRUE(RegexSet::from_sv({"get", "p[ou]t"}));
+}
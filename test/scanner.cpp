@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+//#define DBG_MACRO_DISABLE
+#include "core/dfa.h"
+#include "core/nfa.h"
+#include "core/scanner.h"
+#include "core/table.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+
+struct Collected {
+  std::vector<Token> tokens;
+  std::vector<std::string> texts;
+};
+
+static Scanner collect(const CompiledDfa& dfa, Collected& out) {
+  return Scanner(dfa, [&out](const Token& token, std::string_view text) {
+    out.tokens.push_back(token);
+    out.texts.emplace_back(text);
+  });
+}
+
+// the dfa is kept by reference, a temporary one would dangle
+static_assert(
+    !std::is_constructible_v<Scanner, CompiledDfa&&, Scanner::Callback>);
+static_assert(
+    std::is_constructible_v<Scanner, const CompiledDfa&, Scanner::Callback>);
+
+TEST(scanner, one_chunk) {
+  auto lexer = CompiledDfa::from_dfa(
+      lexer_dfa({"if", R"([_A-Za-z]\w*)", R"(\d+)", R"(\s+)", "=|=="}));
+  Collected out;
+  auto scanner = collect(lexer, out);
+  EXPECT_TRUE(scanner.feed("if x1 == 42"));
+  // 42 may still continue
+  EXPECT_EQ(out.texts.back(), " ");
+  EXPECT_TRUE(scanner.finish());
+  EXPECT_EQ(out.texts, (std::vector<std::string>{"if", " ", "x1", " ", "==",
+                                                 " ", "42"}));
+  EXPECT_EQ(scanner.pos(), 11);
+}
+
+TEST(scanner, straddle) {
+  auto lexer = CompiledDfa::from_dfa(
+      lexer_dfa({"if", R"([_A-Za-z]\w*)", R"(\d+)", R"(\s+)", ";"}));
+  Collected out;
+  auto scanner = collect(lexer, out);
+  for (auto chunk : {"ab", "c 1", "2", "3;", " i", "f", " x;"}) {
+    EXPECT_TRUE(scanner.feed(chunk));
+  }
+  // ';' can not be extended, it is emitted without waiting for more input
+  EXPECT_EQ(out.texts.back(), ";");
+  EXPECT_TRUE(scanner.finish());
+  EXPECT_EQ(out.texts, (std::vector<std::string>{"abc", " ", "123", ";", " ",
+                                                 "if", " ", "x", ";"}));
+  EXPECT_EQ(out.tokens[5].id, 0);
+  EXPECT_EQ(out.tokens[5].pos, 9);
+}
+
+TEST(scanner, error) {
+  auto lexer = CompiledDfa::from_dfa(lexer_dfa({R"(\d+)", R"(\s+)"}));
+  Collected out;
+  auto scanner = collect(lexer, out);
+  EXPECT_TRUE(scanner.feed("12 3"));
+  EXPECT_FALSE(scanner.feed("4 x 5"));
+  EXPECT_EQ(scanner.pos(), 6);
+  EXPECT_FALSE(scanner.feed("6"));
+  EXPECT_FALSE(scanner.finish());
+  EXPECT_EQ(out.texts, (std::vector<std::string>{"12", " ", "34", " "}));
+}
+
+TEST(scanner, same_as_tokenize) {
+  // backtracking across chunks: "1." is no float and has to be rescanned
+  auto lexer = CompiledDfa::from_dfa(
+      lexer_dfa({R"([0-9]+[.][0-9]+)", R"(\d+)", R"([.])", "[-+]", "[.][.]"}));
+  for (int i = 0; i < 500; ++i) {
+    auto src = random_string("01.+", rand() % 60);
+    std::vector<Token> expected;
+    size_t stop = lexer.tokenize(src, expected);
+
+    Collected out;
+    auto scanner = collect(lexer, out);
+    bool ok = true;
+    for (size_t pos = 0; pos < src.size();) {
+      size_t len = rand() % 5;
+      ok &= scanner.feed(std::string_view(src).substr(pos, len));
+      pos += len;
+    }
+    ok &= scanner.finish();
+    EXPECT_EQ(ok, stop == src.size()) << src;
+    EXPECT_EQ(scanner.pos(), stop) << src;
+    ASSERT_EQ(out.tokens.size(), expected.size()) << src;
+    for (size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(out.tokens[j].id, expected[j].id);
+      EXPECT_EQ(out.tokens[j].pos, expected[j].pos);
+      EXPECT_EQ(out.tokens[j].len, expected[j].len);
+      EXPECT_EQ(out.texts[j], src.substr(expected[j].pos, expected[j].len));
+    }
+  }
+}
+
+TEST(scanner, accel) {
+  // string and comment bodies are skipped inside a chunk, an unclosed one
+  // is rescanned across chunks
+  auto lexer = CompiledDfa::from_dfa(
+      lexer_dfa({R"("[^"]*")", R"(/\*[^*]*\*/)", R"(\d+)", "[a-z]",
+                 "[\"/* ]"}),
+      Layout::kDense);
+  ASSERT_FALSE(std::get<DenseTable<u8>>(lexer.table).accel.empty());
+  for (int i = 0; i < 200; ++i) {
+    std::string src;
+    while (src.size() < 200) {
+      src += random_string("\"/* ab01", rand() % 4);
+      src += random_string(rand() % 2 ? "0123456789" : "abc xyz", rand() % 40);
+    }
+    std::vector<Token> expected;
+    size_t stop = lexer.tokenize(src, expected);
+
+    Collected out;
+    auto scanner = collect(lexer, out);
+    for (size_t pos = 0; pos < src.size();) {
+      size_t len = rand() % 50;
+      scanner.feed(std::string_view(src).substr(pos, len));
+      pos += len;
+    }
+    EXPECT_EQ(scanner.finish(), stop == src.size()) << src;
+    ASSERT_EQ(out.tokens.size(), expected.size()) << src;
+    for (size_t j = 0; j < expected.size(); ++j) {
+      ASSERT_EQ(out.tokens[j].id, expected[j].id) << src;
+      ASSERT_EQ(out.tokens[j].len, expected[j].len) << src;
+    }
+  }
+}
+
+TEST(scanner, linear_time) {
+  auto lexer = CompiledDfa::from_dfa(lexer_dfa({"a", "a*b"}));
+  size_t count = 0;
+  Scanner scanner(lexer, [&count](const Token& token, std::string_view text) {
+    EXPECT_EQ(token.id, 0);
+    EXPECT_EQ(text, "a");
+    ++count;
+  });
+  std::string chunk(1000, 'a');
+  for (int i = 0; i < 200; ++i) EXPECT_TRUE(scanner.feed(chunk));
+  EXPECT_TRUE(scanner.finish());
+  EXPECT_EQ(count, 200000);
+
+  // every rescan enters the accel run of [^x]*, which fails at the end
+  auto accel = CompiledDfa::from_dfa(lexer_dfa({"a", "[^x]*x"}));
+  ASSERT_FALSE(std::get<DenseTable<u8>>(accel.table).accel.empty());
+  count = 0;
+  Scanner rescans(accel, [&count](const Token& token, std::string_view text) {
+    EXPECT_EQ(token.id, 0);
+    ++count;
+  });
+  chunk.assign(100000, 'a');
+  for (int i = 0; i < 2; ++i) EXPECT_TRUE(rescans.feed(chunk));
+  EXPECT_TRUE(rescans.finish());
+  EXPECT_EQ(count, 200000);
+}
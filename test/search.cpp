@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/dfa.h"
+#include "core/nfa.h"
+#include "core/search.h"
+#include "core/table.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+
+// restarts the anchored dfa at every offset
+static std::vector<Match> naive_find_all(const CompiledDfa& dfa,
+                                         std::string_view sv) {
+  std::vector<Match> matches;
+  size_t pos = 0;
+  while (pos <= sv.size()) {
+    std::optional<Match> match;
+    for (size_t begin = pos; begin <= sv.size() && !match; ++begin) {
+      if (auto token = dfa.scan(sv, begin)) {
+        match = Match{token->id, begin, begin + token->len};
+      }
+    }
+    if (!match) break;
+    matches.push_back(*match);
+    pos = match->end > match->begin ? match->end : match->end + 1;
+  }
+  return matches;
+}
+
+TEST(search, find) {
+  auto searcher = *Searcher::from_sv("ab+");
+  auto match = searcher.find("xxabbbxab");
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->begin, 2);
+  EXPECT_EQ(match->end, 6);
+  match = searcher.find("xxabbbxab", 3);
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->begin, 7);
+  EXPECT_EQ(match->end, 9);
+  EXPECT_FALSE(searcher.find("xxabbbxab", 8));
+  EXPECT_FALSE(searcher.find("bbba"));
+}
+
+TEST(search, leftmost_longest) {
+  // the earliest end belongs to c, the leftmost match is abcd
+  auto searcher = *Searcher::from_sv("abcd|c");
+  auto match = searcher.find("xabcd");
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->begin, 1);
+  EXPECT_EQ(match->end, 5);
+  // abc fails, so c is the leftmost
+  match = searcher.find("xabcx");
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->begin, 3);
+  EXPECT_EQ(match->end, 4);
+}
+
+TEST(search, rule_id) {
+  std::vector<std::unique_ptr<re::Re>> res;
+  res.push_back(re::Re::parse("if"));
+  res.push_back(re::Re::parse("[a-z]+"));
+  auto searcher = *Searcher::from_nfa(nfa::Nfa::from_re(std::move(res)));
+  auto matches = searcher.find_all("1 if 2 iff");
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches[0].id, 0);
+  EXPECT_EQ(matches[0].begin, 2);
+  EXPECT_EQ(matches[0].end, 4);
+  EXPECT_EQ(matches[1].id, 1);
+  EXPECT_EQ(matches[1].begin, 7);
+  EXPECT_EQ(matches[1].end, 10);
+}
+
+TEST(search, empty_match) {
+  auto searcher = *Searcher::from_sv("a*");
+  auto matches = searcher.find_all("baa");
+  ASSERT_EQ(matches.size(), 3);
+  EXPECT_EQ(matches[0].begin, 0);
+  EXPECT_EQ(matches[0].end, 0);
+  EXPECT_EQ(matches[1].begin, 1);
+  EXPECT_EQ(matches[1].end, 3);
+  EXPECT_EQ(matches[2].begin, 3);
+  EXPECT_EQ(matches[2].end, 3);
+  EXPECT_EQ(searcher.count("baa"), 3);
+}
+
+TEST(search, same_as_naive) {
+  srand(7);
+  for (auto pattern : {"a*b", "ab|b", "[ab]*abb", "aab|a", "abcd|bc|c",
+                       "(ab)*c", "b[ac]*b", "a[bc]*|bc+"}) {
+    auto searcher = *Searcher::from_sv(pattern);
+    auto anchored = CompiledDfa::from_dfa(Dfa::from_sv(pattern));
+    for (int i = 0; i < 500; ++i) {
+      auto s = random_string("abcx", rand() % 24);
+      auto expected = naive_find_all(anchored, s);
+      auto matches = searcher.find_all(s);
+      ASSERT_EQ(matches.size(), expected.size()) << pattern << " " << s;
+      for (size_t j = 0; j < matches.size(); ++j) {
+        EXPECT_EQ(matches[j].id, expected[j].id);
+        EXPECT_EQ(matches[j].begin, expected[j].begin) << pattern << " " << s;
+        EXPECT_EQ(matches[j].end, expected[j].end) << pattern << " " << s;
+      }
+      EXPECT_EQ(searcher.count(s), expected.size());
+    }
+  }
+}
+
+TEST(search, bad_pattern) {
+  // reported, not a process exit
+  EXPECT_FALSE(Searcher::from_sv("(ab"));
+  EXPECT_FALSE(Searcher::from_sv("a]"));
+  EXPECT_TRUE(Searcher::from_sv("[ab]"));
+}
+
+TEST(search, too_big) {
+  // over the 1024 nfa nodes the unanchored construction handles
+  std::vector<std::unique_ptr<re::Re>> res;
+  for (int i = 0; i < 400; ++i) {
+    res.push_back(re::Re::parse("kw" + std::to_string(i * 7)));
+  }
+  auto nfa = nfa::Nfa::from_re(std::move(res));
+  EXPECT_FALSE(Searcher::unanchored_from_nfa(nfa));
+  EXPECT_FALSE(Searcher::from_nfa(std::move(nfa)));
+}
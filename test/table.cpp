@@ -0,0 +1,496 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/dfa.h"
+#include "core/table.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+
+TEST(dense, single_char) {
+  auto table = DenseTable<u32>::from_dfa(Dfa::from_sv("a"));
+  EXPECT_TRUE(table.accept("a"));
+  EXPECT_FALSE(table.accept(""));
+  EXPECT_FALSE(table.accept("b"));
+  EXPECT_FALSE(table.accept("aa"));
+  EXPECT_FALSE(table.accept("\xff"));
+}
+
+TEST(dense, dead_state) {
+  auto table = DenseTable<u32>::from_dfa(Dfa::from_sv(R"([1-9][0-9]*)"));
+  EXPECT_FALSE(table.accept("0123"));
+  EXPECT_FALSE(table.accept("12a3"));
+  EXPECT_EQ(table.terminals[DenseTable<u32>::DEAD_STATE], std::nullopt);
+  auto dead_row = DenseTable<u32>::DEAD_STATE << table.stride_shift;
+  for (u32 k = 0; k < (1u << table.stride_shift); ++k) {
+    EXPECT_EQ(table.trans[dead_row | k], DenseTable<u32>::DEAD_STATE);
+  }
+}
+
+TEST(dense, same_as_dfa) {
+  const char* patterns[] = {
+      R"(\d+|(0x[0-9a-fA-F]+))",
+      R"([_A-Za-z]\w*)",
+      R"([-+]?[0-9]*[.][0-9]*([eE][-+]?[0-9]+)?)",
+  };
+  for (auto pattern : patterns) {
+    auto dfa = Dfa::from_sv(pattern);
+    auto table = DenseTable<u32>::from_dfa(dfa);
+    for (int i = 0; i < 2000; ++i) {
+      auto s = random_string("0123456789abcxXeE_.+-", rand() % 12);
+      ASSERT_EQ(table.accept(s), dfa.accept(s)) << pattern << " " << s;
+    }
+  }
+}
+
+TEST(dense, byte_classes) {
+  // '0', [1-9], 'x', [a-fA-F] and everything else
+  auto dfa = Dfa::from_sv(R"(\d+|(0x[0-9a-fA-F]+))");
+  auto table = DenseTable<u32>::from_dfa(dfa);
+  EXPECT_EQ(table.stride_shift, 3);
+  EXPECT_EQ(table.class_map['1'], table.class_map['9']);
+  EXPECT_EQ(table.class_map['a'], table.class_map['F']);
+  EXPECT_NE(table.class_map['0'], table.class_map['1']);
+  EXPECT_NE(table.class_map['x'], table.class_map['y']);
+  EXPECT_TRUE(table.accept("0x1aF"));
+  EXPECT_FALSE(table.accept("0xg"));
+}
+
+TEST(dense, accel) {
+  auto str = DenseTable<u8>::from_dfa(Dfa::from_sv(R"("[^"]*")"));
+  ASSERT_FALSE(str.accel.empty());
+  auto body = str.next(str.START_STATE, '"');
+  EXPECT_EQ(str.accel[body].kind, Accel::kEscape);
+  EXPECT_EQ(str.accel[body].num, 1);
+  EXPECT_EQ(str.accel[body].bytes[0], '"');
+  EXPECT_EQ(str.accel[str.DEAD_STATE].kind, Accel::kEscape);
+  EXPECT_EQ(str.accel[str.DEAD_STATE].num, 0);
+
+  auto word = DenseTable<u8>::from_dfa(Dfa::from_sv("[a-z]+"));
+  ASSERT_FALSE(word.accel.empty());
+  auto letters = word.accel[word.next(word.START_STATE, 'q')];
+  EXPECT_EQ(letters.kind, Accel::kRange);
+  EXPECT_EQ(letters.bytes[0], 'a');
+  EXPECT_EQ(letters.bytes[1], 'z');
+
+  // no state but the dead one loops on itself
+  EXPECT_TRUE(DenseTable<u8>::from_dfa(Dfa::from_sv("abc")).accel.empty());
+  // loops on a few bytes only, runs would be short
+  EXPECT_TRUE(DenseTable<u8>::from_dfa(Dfa::from_sv("a+b")).accel.empty());
+  EXPECT_TRUE(DenseTable<u8>::from_dfa(Dfa::from_sv("x[0-5]*")).accel.empty());
+  auto number = DenseTable<u8>::from_dfa(Dfa::from_sv(R"(\d+)"));
+  ASSERT_FALSE(number.accel.empty());
+  auto digits = number.accel[number.next(number.START_STATE, '7')];
+  EXPECT_EQ(digits.kind, Accel::kRange);
+  EXPECT_EQ(digits.bytes[0], '0');
+  EXPECT_EQ(digits.bytes[1], '9');
+  EXPECT_TRUE(
+      DenseTable<u8>::from_dfa(Dfa::from_sv("[a-z]+"), false).accel.empty());
+}
+
+TEST(dense, accel_same_as_dfa) {
+  const char* patterns[] = {
+      R"("[^"]*")",
+      R"(<[^<>&]*>)",
+      R"([a-z]+|\d+)",
+      R"(/\*[^*]*\*/)",
+  };
+  for (auto pattern : patterns) {
+    auto dfa = Dfa::from_sv(pattern);
+    auto table = DenseTable<u16>::from_dfa(dfa);
+    ASSERT_FALSE(table.accel.empty()) << pattern;
+    for (int i = 0; i < 2000; ++i) {
+      auto s = random_string("\"<>&/*az09xyz____________", rand() % 80);
+      if (rand() % 2) s = s.substr(0, 1) + random_string("abcxyz", 40) + s;
+      ASSERT_EQ(table.accept(s), dfa.accept(s)) << pattern << " " << s;
+    }
+  }
+}
+
+TEST(compiled, narrow_state) {
+  auto small = CompiledDfa::from_dfa(Dfa::from_sv(R"([_A-Za-z]\w*)"));
+  EXPECT_TRUE(std::holds_alternative<DenseTable<u8>>(small.table));
+  EXPECT_TRUE(small.accept("a1"));
+  EXPECT_FALSE(small.accept("1a"));
+
+  // a chain of 300 states needs u16 indices
+  std::string chain(300, 'a');
+  auto dfa = Dfa::from_sv(chain);
+  auto large = CompiledDfa::from_dfa(dfa);
+  EXPECT_TRUE(std::holds_alternative<DenseTable<u16>>(large.table));
+  EXPECT_EQ(large.state_num(), dfa.nodes.size() + 1);
+  EXPECT_TRUE(large.accept(chain));
+  EXPECT_FALSE(large.accept(chain.substr(1)));
+  EXPECT_FALSE(large.accept(chain + "a"));
+}
+
+TEST(compiled, same_as_dense) {
+  auto dfa = Dfa::from_sv(R"([-+]?[0-9]*[.][0-9]*([eE][-+]?[0-9]+)?)");
+  auto wide = DenseTable<u32>::from_dfa(dfa);
+  auto compiled = CompiledDfa::from_dfa(dfa);
+  for (int i = 0; i < 2000; ++i) {
+    auto s = random_string("0123456789eE.+-", rand() % 12);
+    ASSERT_EQ(compiled.accept(s), wide.accept(s)) << s;
+  }
+}
+
+TEST(comb, same_as_dense) {
+  const char* patterns[] = {
+      R"(\d+|(0x[0-9a-fA-F]+))",
+      R"([_A-Za-z]\w*)",
+      R"([-+]?[0-9]*[.][0-9]*([eE][-+]?[0-9]+)?)",
+  };
+  for (auto pattern : patterns) {
+    auto dfa = Dfa::from_sv(pattern);
+    auto dense = DenseTable<u32>::from_dfa(dfa);
+    auto comb = CombTable::from_dfa(dfa);
+    EXPECT_EQ(comb.state_num(), dense.state_num());
+    for (int i = 0; i < 2000; ++i) {
+      auto s = random_string("0123456789abcxXeE_.+-", rand() % 12);
+      ASSERT_EQ(comb.accept(s), dense.accept(s)) << pattern << " " << s;
+    }
+  }
+}
+
+TEST(comb, keywords) {
+  const char* keywords[] = {"if",     "else",   "while", "for",    "do",
+                            "return", "break",  "int",   "char",   "void",
+                            "struct", "switch", "case",  "default"};
+  std::vector<std::unique_ptr<parsergen::re::Re>> res;
+  for (auto kw : keywords) res.push_back(parsergen::re::Re::parse(kw));
+  res.push_back(parsergen::re::Re::parse(R"([_A-Za-z]\w*)"));
+  auto dfa = Dfa::from_nfa(parsergen::nfa::Nfa::from_re(std::move(res)));
+
+  auto dense = CompiledDfa::from_dfa(dfa, Layout::kDense);
+  auto comb = CompiledDfa::from_dfa(dfa, Layout::kComb);
+  EXPECT_TRUE(std::holds_alternative<CombTable>(comb.table));
+  for (u32 id = 0; id < std::size(keywords); ++id) {
+    EXPECT_EQ(comb.accept(keywords[id]), id);
+  }
+  EXPECT_EQ(comb.accept("iff"), std::size(keywords));
+  EXPECT_FALSE(comb.accept("1f"));
+  for (int i = 0; i < 2000; ++i) {
+    auto s = random_string("ifelsworudnt_1", rand() % 8);
+    ASSERT_EQ(comb.accept(s), dense.accept(s)) << s;
+  }
+}
+
+TEST(sparse, rank) {
+  alignas(16) u8 lo[SparseTable::MAX_RANGES] = {0, '0', '9' + 1, 'A', 'G'};
+  EXPECT_EQ(SparseTable::rank(lo, 5, 0), 1);
+  EXPECT_EQ(SparseTable::rank(lo, 5, '0'), 2);
+  EXPECT_EQ(SparseTable::rank(lo, 5, '9'), 2);
+  EXPECT_EQ(SparseTable::rank(lo, 5, ':'), 3);
+  EXPECT_EQ(SparseTable::rank(lo, 5, 'F'), 4);
+  EXPECT_EQ(SparseTable::rank(lo, 5, 0xff), 5);
+  EXPECT_EQ(SparseTable::rank(lo, 3, 0xff), 3);
+}
+
+TEST(sparse, same_as_dense) {
+  const char* patterns[] = {
+      R"(\d+|(0x[0-9a-fA-F]+))",
+      R"([_A-Za-z]\w*)",
+      R"([-+]?[0-9]*[.][0-9]*([eE][-+]?[0-9]+)?)",
+      R"("[^"]*")",
+  };
+  for (auto pattern : patterns) {
+    auto dfa = Dfa::from_sv(pattern);
+    auto dense = DenseTable<u32>::from_dfa(dfa);
+    auto sparse = SparseTable::from_dfa(dfa);
+    EXPECT_EQ(sparse.state_num(), dense.state_num());
+    for (int i = 0; i < 2000; ++i) {
+      auto s = random_string("0123456789abcxXeE_.+-\"\xf0", rand() % 12);
+      ASSERT_EQ(sparse.accept(s), dense.accept(s)) << pattern << " " << s;
+    }
+  }
+}
+
+TEST(sparse, hex_ranges) {
+  // the letter runs split the alphabet into many classes
+  auto dfa = Dfa::from_sv(R"(0x[0-9a-fA-F]+|g|hh|iii|jjjj|kkkkk|llllll)");
+  auto sparse = CompiledDfa::from_dfa(dfa, Layout::kSparse);
+  auto& table = std::get<SparseTable>(sparse.table);
+  // the hex digit states keep [0-9], [A-F], [a-f] and the dead gaps
+  u32 hex_state = table.next(table.next(SparseTable::START_STATE, '0'), 'x');
+  EXPECT_EQ(table.entries[hex_state].range_num, 7);
+  EXPECT_TRUE(sparse.accept("0xdeadBEEF"));
+  EXPECT_TRUE(sparse.accept("iii"));
+  EXPECT_FALSE(sparse.accept("ii"));
+  EXPECT_FALSE(sparse.accept("0xg"));
+  EXPECT_FALSE(sparse.accept("0x"));
+}
+
+TEST(compiled, autotune) {
+  const char* patterns[] = {
+      R"(\d+|(0x[0-9a-fA-F]+))",
+      R"([_A-Za-z]\w*)",
+      R"(0x[0-9a-fA-F]+|g|hh|iii|jjjj|kkkkk|llllll)",
+  };
+  for (auto pattern : patterns) {
+    auto dfa = Dfa::from_sv(pattern);
+    auto dense = CompiledDfa::from_dfa(dfa);
+    auto tuned = CompiledDfa::from_dfa(dfa, Layout::kAuto);
+    auto sample = random_string("0123456789abcxghijkl_", 4096);
+    auto tuned_on_sample = CompiledDfa::from_dfa(dfa, Layout::kAuto, sample);
+    // never the stride-2 table, whatever its speed
+    EXPECT_LT(tuned.memory(), Stride2Table::from_dfa(dfa).memory());
+    for (int i = 0; i < 2000; ++i) {
+      auto s = random_string("0123456789abcxghijkl_", rand() % 12);
+      ASSERT_EQ(tuned.accept(s), dense.accept(s)) << pattern << " " << s;
+      ASSERT_EQ(tuned_on_sample.accept(s), dense.accept(s));
+    }
+  }
+}
+
+TEST(stride2, same_as_dense) {
+  const char* patterns[] = {
+      R"(\d+|(0x[0-9a-fA-F]+))",
+      R"([_A-Za-z]\w*)",
+      R"([-+]?[0-9]*[.][0-9]*([eE][-+]?[0-9]+)?)",
+  };
+  for (auto pattern : patterns) {
+    auto dfa = Dfa::from_sv(pattern);
+    auto dense = DenseTable<u32>::from_dfa(dfa);
+    auto stride2 = Stride2Table::from_dfa(dfa);
+    EXPECT_EQ(stride2.class_shift, dense.stride_shift);
+    for (int i = 0; i < 2000; ++i) {
+      auto s = random_string("0123456789abcxXeE_.+-", rand() % 13);
+      ASSERT_EQ(stride2.accept(s), dense.accept(s)) << pattern << " " << s;
+      ASSERT_EQ(scan(stride2, s, 0).has_value(), scan(dense, s, 0).has_value());
+      if (auto token = scan(stride2, s, 0)) {
+        EXPECT_EQ(token->id, scan(dense, s, 0)->id) << pattern << " " << s;
+        EXPECT_EQ(token->len, scan(dense, s, 0)->len) << pattern << " " << s;
+      }
+    }
+  }
+}
+
+TEST(compiled, accept_batch) {
+  auto dfa = Dfa::from_sv(R"([-+]?[0-9]*[.][0-9]*([eE][-+]?[0-9]+)?)");
+  std::vector<std::string> strings;
+  for (int i = 0; i < 1000; ++i) {
+    strings.push_back(random_string("0123456789eE.+-x", rand() % 24));
+  }
+  std::vector<std::string_view> inputs(strings.begin(), strings.end());
+  for (auto layout : {Layout::kDense, Layout::kComb, Layout::kSparse,
+                      Layout::kStride2, Layout::kShuffle}) {
+    auto compiled = CompiledDfa::from_dfa(dfa, layout);
+    for (size_t n : {0, 1, 7, 8, 9, 1000}) {
+      std::vector<std::optional<u32>> out(n, 42);
+      compiled.accept_batch(inputs.data(), out.data(), n);
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(out[i], compiled.accept(inputs[i])) << inputs[i];
+      }
+    }
+  }
+}
+
+template <typename StateT>
+static void check_gather(const Dfa& dfa) {
+  auto table = DenseTable<StateT>::from_dfa(dfa);
+  std::vector<std::string> strings;
+  for (int i = 0; i < 500; ++i) {
+    strings.push_back(random_string("0123456789abcdefx", rand() % 64));
+  }
+  std::vector<std::string_view> inputs(strings.begin(), strings.end());
+  std::vector<std::optional<u32>> out(inputs.size());
+  if (!accept_batch_gather(table, inputs.data(), out.data(), inputs.size())) {
+    GTEST_SKIP() << "no avx2";
+  }
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    ASSERT_EQ(out[i], table.accept(inputs[i])) << inputs[i];
+  }
+}
+
+TEST(compiled, accept_batch_gather) {
+  auto dfa = Dfa::from_sv("[0-9a-f]*x[0-9a-f]*x[0-9]*");
+  check_gather<u8>(dfa);
+  check_gather<u16>(dfa);
+  check_gather<u32>(dfa);
+}
+
+TEST(shuffle, same_as_dense) {
+  const char* patterns[] = {
+      "0x[0-9a-fA-F]+",
+      "true|false",
+      "[0-9a-f]*x[0-9a-f]*x[0-9]*",
+  };
+  for (auto pattern : patterns) {
+    auto dfa = Dfa::from_sv(pattern);
+    auto dense = DenseTable<u8>::from_dfa(dfa);
+    auto shuffle = ShuffleTable::from_dfa(dfa);
+    ASSERT_EQ(shuffle.state_num(), dense.state_num());
+    for (u32 state = 0; state < dense.state_num(); ++state) {
+      for (int c = 0; c < 256; ++c) {
+        ASSERT_EQ(shuffle.next(state, c), dense.next(state, c));
+      }
+    }
+    for (int i = 0; i < 2000; ++i) {
+      auto s = random_string("0123456789abcdefxtrulsF", rand() % 200);
+      if (i % 3 == 0) s = "0x" + random_string("0123456789abcdefF", i % 100);
+      ASSERT_EQ(shuffle.accept(s), dense.accept(s)) << pattern << " " << s;
+    }
+  }
+}
+
+TEST(shuffle, too_many_states) {
+  auto small =
+      CompiledDfa::from_dfa(Dfa::from_sv("true|false"), Layout::kShuffle);
+  EXPECT_TRUE(std::holds_alternative<ShuffleTable>(small.table));
+  EXPECT_TRUE(small.accept("false"));
+  auto large = CompiledDfa::from_dfa(Dfa::from_sv("abcdefghijklmnopqrstuvwxyz"),
+                                     Layout::kShuffle);
+  EXPECT_TRUE(std::holds_alternative<DenseTable<u8>>(large.table));
+  EXPECT_TRUE(large.accept("abcdefghijklmnopqrstuvwxyz"));
+}
+
+TEST(lexer, scan) {
+  // 0: keyword, 1: ident, 2: number, 3: blank
+  auto dfa = lexer_dfa({"if", R"([_A-Za-z]\w*)", R"(\d+)", R"(\s+)"});
+  for (auto layout : {Layout::kDense, Layout::kComb, Layout::kSparse,
+                      Layout::kStride2}) {
+    auto lexer = CompiledDfa::from_dfa(dfa, layout);
+    auto token = lexer.scan("if x1");
+    ASSERT_TRUE(token);
+    EXPECT_EQ(token->id, 0);
+    EXPECT_EQ(token->len, 2);
+    // longest match wins over the keyword
+    token = lexer.scan("iffy");
+    ASSERT_TRUE(token);
+    EXPECT_EQ(token->id, 1);
+    EXPECT_EQ(token->len, 4);
+    token = lexer.scan("if x1", 3);
+    ASSERT_TRUE(token);
+    EXPECT_EQ(token->id, 1);
+    EXPECT_EQ(token->pos, 3);
+    EXPECT_EQ(token->len, 2);
+    EXPECT_FALSE(lexer.scan("+1"));
+    EXPECT_FALSE(lexer.scan(""));
+  }
+}
+
+TEST(lexer, mid_pair) {
+  auto lexer = CompiledDfa::from_dfa(lexer_dfa({"a", "abc", "abcde"}),
+                                     Layout::kStride2);
+  // the longest match ends between the two bytes of a pair
+  auto token = lexer.scan("abx");
+  ASSERT_TRUE(token);
+  EXPECT_EQ(token->id, 0);
+  EXPECT_EQ(token->len, 1);
+  token = lexer.scan("abcdx");
+  ASSERT_TRUE(token);
+  EXPECT_EQ(token->id, 1);
+  EXPECT_EQ(token->len, 3);
+  // odd trailing byte
+  token = lexer.scan("abcde");
+  ASSERT_TRUE(token);
+  EXPECT_EQ(token->id, 2);
+  EXPECT_EQ(token->len, 5);
+  EXPECT_FALSE(lexer.scan("x"));
+}
+
+TEST(lexer, tokenize) {
+  auto dfa = lexer_dfa({"if", R"([_A-Za-z]\w*)", R"(\d+)", R"(\s+)", "=|=="});
+  auto lexer = CompiledDfa::from_dfa(dfa);
+  std::string_view src = "if x1 == 42 iff";
+  std::vector<Token> tokens;
+  EXPECT_EQ(lexer.tokenize(src, tokens), src.size());
+  std::vector<std::pair<u32, std::string_view>> expected = {
+      {0, "if"}, {3, " "}, {1, "x1"},  {3, " "},
+      {4, "=="}, {3, " "}, {2, "42"},  {3, " "}, {1, "iff"}};
+  ASSERT_EQ(tokens.size(), expected.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    EXPECT_EQ(tokens[i].id, expected[i].first);
+    EXPECT_EQ(src.substr(tokens[i].pos, tokens[i].len), expected[i].second);
+  }
+
+  tokens.clear();
+  EXPECT_EQ(lexer.tokenize("x = 1 + 2", tokens), 6);
+  EXPECT_EQ(tokens.size(), 6);
+}
+
+TEST(lexer, same_as_scan) {
+  auto dfa = lexer_dfa({R"([-+]?[0-9]*[.][0-9]*([eE][-+]?[0-9]+)?)",
+                        R"(\d+)", R"([eE]+)", R"([.]+)", "[-+]"});
+  auto lexer = CompiledDfa::from_dfa(dfa);
+  for (int i = 0; i < 500; ++i) {
+    auto src = random_string("0123.eE+-", rand() % 40);
+    std::vector<Token> expected;
+    size_t pos = 0;
+    while (auto token = lexer.scan(src, pos)) {
+      if (token->len == 0) break;
+      expected.push_back(*token);
+      pos += token->len;
+    }
+    std::vector<Token> tokens;
+    ASSERT_EQ(lexer.tokenize(src, tokens), pos) << src;
+    ASSERT_EQ(tokens.size(), expected.size()) << src;
+    for (size_t j = 0; j < tokens.size(); ++j) {
+      EXPECT_EQ(tokens[j].id, expected[j].id);
+      EXPECT_EQ(tokens[j].pos, expected[j].pos);
+      EXPECT_EQ(tokens[j].len, expected[j].len);
+    }
+  }
+}
+
+TEST(lexer, accel_same_as_plain) {
+  // strings, comments and numbers skip their bodies, an unclosed string or
+  // comment is rescanned from every later byte
+  auto dfa = lexer_dfa({R"("[^"]*")", R"(/\*[^*]*\*/)", R"(\d+)", "[a-z]",
+                        "[\"/* ]"});
+  auto plain = DenseTable<u8>::from_dfa(dfa, false);
+  auto table = DenseTable<u8>::from_dfa(dfa);
+  ASSERT_FALSE(table.accel.empty());
+  for (int i = 0; i < 500; ++i) {
+    std::string src;
+    while (src.size() < 200) {
+      src += random_string("\"/* ab01", rand() % 4);
+      src += random_string(rand() % 2 ? "0123456789" : "abc xyz", rand() % 40);
+    }
+    for (size_t pos = 0; pos < src.size(); pos += 17) {
+      auto expected = scan(plain, src, pos);
+      auto token = scan(table, src, pos);
+      ASSERT_EQ(token.has_value(), expected.has_value()) << src;
+      if (token) {
+        ASSERT_EQ(token->len, expected->len) << src;
+      }
+    }
+    std::vector<Token> expected, tokens;
+    ASSERT_EQ(tokenize(table, src, tokens), tokenize(plain, src, expected));
+    ASSERT_EQ(tokens.size(), expected.size()) << src;
+    for (size_t j = 0; j < tokens.size(); ++j) {
+      ASSERT_EQ(tokens[j].id, expected[j].id) << src;
+      ASSERT_EQ(tokens[j].len, expected[j].len) << src;
+    }
+  }
+}
+
+TEST(lexer, linear_time) {
+  // scanning for a*b from every a of a long run is quadratic
+  auto dfa = lexer_dfa({"a", "a*b"});
+  auto lexer = CompiledDfa::from_dfa(dfa);
+  std::string src(200000, 'a');
+  std::vector<Token> tokens;
+  EXPECT_EQ(lexer.tokenize(src, tokens), src.size());
+  EXPECT_EQ(tokens.size(), src.size());
+  for (auto& token : tokens) ASSERT_EQ(token.id, 0);
+
+  tokens.clear();
+  src.push_back('b');
+  EXPECT_EQ(lexer.tokenize(src, tokens), src.size());
+  ASSERT_EQ(tokens.size(), 1);
+  EXPECT_EQ(tokens[0].id, 1);
+
+  // every rescan enters the accel run of [^x]*, which fails at the end
+  auto accel = CompiledDfa::from_dfa(lexer_dfa({"a", "[^x]*x"}));
+  ASSERT_FALSE(std::get<DenseTable<u8>>(accel.table).accel.empty());
+  src.assign(200000, 'a');
+  tokens.clear();
+  EXPECT_EQ(accel.tokenize(src, tokens), src.size());
+  EXPECT_EQ(tokens.size(), src.size());
+  for (auto& token : tokens) ASSERT_EQ(token.id, 0);
+}
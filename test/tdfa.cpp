@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <regex>
+#include <string>
+#include <string_view>
+
+//#define DBG_MACRO_DISABLE
+#include "core/nfa.h"
+#include "core/re.h"
+#include "core/tdfa.h"
+#include "util.h"
+
+using namespace parsergen;
+using namespace parsergen::dfa;
+
+static constexpr size_t npos = std::string_view::npos;
+
+TEST(tdfa, groups) {
+  auto tdfa = TaggedDfa::from_sv(R"((\d+)[.](\d+) ([a-z]+))");
+  ASSERT_TRUE(tdfa);
+  EXPECT_EQ(tdfa->group_num(), 3);
+  std::vector<Span> spans;
+  ASSERT_EQ(tdfa->match("12.345 get", spans), 0);
+  ASSERT_EQ(spans.size(), 4);
+  EXPECT_EQ(spans[0].begin, 0);
+  EXPECT_EQ(spans[0].end, 10);
+  EXPECT_EQ(spans[1].begin, 0);
+  EXPECT_EQ(spans[1].end, 2);
+  EXPECT_EQ(spans[2].begin, 3);
+  EXPECT_EQ(spans[2].end, 6);
+  EXPECT_EQ(spans[3].begin, 7);
+  EXPECT_EQ(spans[3].end, 10);
+  EXPECT_FALSE(tdfa->match("12.345", spans));
+}
+
+TEST(tdfa, greedy) {
+  auto tdfa = TaggedDfa::from_sv("(a*)(a*)");
+  ASSERT_TRUE(tdfa);
+  std::vector<Span> spans;
+  ASSERT_TRUE(tdfa->match("aaa", spans));
+  EXPECT_EQ(spans[1].end, 3);
+  EXPECT_EQ(spans[2].begin, 3);
+  EXPECT_EQ(spans[2].end, 3);
+}
+
+TEST(tdfa, not_taking_part) {
+  auto tdfa = TaggedDfa::from_sv("(a)|(b)");
+  ASSERT_TRUE(tdfa);
+  std::vector<Span> spans;
+  ASSERT_TRUE(tdfa->match("b", spans));
+  EXPECT_EQ(spans[1].begin, npos);
+  EXPECT_EQ(spans[1].end, npos);
+  EXPECT_EQ(spans[2].begin, 0);
+  EXPECT_EQ(spans[2].end, 1);
+}
+
+TEST(tdfa, same_as_std_regex) {
+  srand(24);
+  for (auto pattern : {"(a*)(b*)", "([ab]*)(b)", "(a+)(a*)b", "(ab)*c",
+                       "([ab]*)([bc]+)", "(a?)(ab)?b", "x(a*)(ab)*(b*)",
+                       "(a)*(b)+", "([abc]*)(c)([abc]*)"}) {
+    auto tdfa = TaggedDfa::from_sv(pattern);
+    ASSERT_TRUE(tdfa);
+    std::regex expected(pattern);
+    std::vector<Span> spans;
+    for (int i = 0; i < 300; ++i) {
+      auto s = random_string("abcx", rand() % 10);
+      std::smatch m;
+      bool matched = std::regex_match(s, m, expected);
+      ASSERT_EQ(tdfa->match(s, spans).has_value(), matched)
+          << pattern << " " << s;
+      if (!matched) continue;
+      ASSERT_EQ(spans.size(), m.size());
+      for (size_t k = 1; k < m.size(); ++k) {
+        if (!m[k].matched) {
+          EXPECT_EQ(spans[k].begin, npos) << pattern << " " << s << " " << k;
+          continue;
+        }
+        EXPECT_EQ(spans[k].begin, (size_t)m.position(k))
+            << pattern << " " << s << " " << k;
+        EXPECT_EQ(spans[k].end, (size_t)(m.position(k) + m.length(k)))
+            << pattern << " " << s << " " << k;
+      }
+    }
+  }
+}
+
+TEST(tdfa, rule_ids) {
+  std::vector<std::unique_ptr<re::Re>> res;
+  res.push_back(re::Re::parse("GET (/[a-z]*)"));
+  res.push_back(re::Re::parse("([A-Z]+) (/[a-z/]*)"));
+  auto tdfa = TaggedDfa::from_re(std::move(res));
+  ASSERT_TRUE(tdfa);
+  std::vector<Span> spans;
+  ASSERT_EQ(tdfa->match("GET /index", spans), 0);
+  EXPECT_EQ(spans[1].begin, 4);
+  EXPECT_EQ(spans[1].end, 10);
+  ASSERT_EQ(tdfa->match("PUT /a/b", spans), 1);
+  EXPECT_EQ(spans[1].end, 3);
+  EXPECT_EQ(spans[2].begin, 4);
+}
+
+TEST(tdfa, max_states) {
+  auto tdfa = TaggedDfa::from_sv("(a*)(b*)c");
+  ASSERT_TRUE(tdfa);
+  u32 state_num = tdfa->state_num();
+  auto re = re::Re::parse("(a*)(b*)c");
+  u32 groups = re::group_num(*re);
+  auto nfa = nfa::Nfa::from_re(std::move(re));
+  EXPECT_TRUE(TaggedDfa::from_nfa(nfa, groups, state_num));
+  EXPECT_FALSE(TaggedDfa::from_nfa(nfa, groups, state_num - 1));
+}
+
+TEST(tdfa, reused_registers) {
+  auto tdfa = TaggedDfa::from_sv("([a-z]+)=([0-9]*)");
+  ASSERT_TRUE(tdfa);
+  std::vector<Span> spans;
+  std::vector<size_t> regs;
+  ASSERT_TRUE(tdfa->match("key=42", spans, regs));
+  size_t capacity = regs.capacity();
+  ASSERT_TRUE(tdfa->match("k=", spans, regs));
+  EXPECT_EQ(spans[1].end, 1);
+  EXPECT_EQ(spans[2].begin, 2);
+  EXPECT_EQ(spans[2].end, 2);
+  EXPECT_FALSE(tdfa->match("k", spans, regs));
+  EXPECT_EQ(regs.capacity(), capacity);
+}
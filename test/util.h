@@ -0,0 +1,37 @@
+#ifndef __TEST_UTIL_H
+#define __TEST_UTIL_H
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/dfa.h"
+#include "core/nfa.h"
+#include "core/re.h"
+
+// len bytes drawn from alphabet, seeded by the tests' rand()
+inline std::string random_string(std::string_view alphabet, size_t len) {
+  std::string s;
+  for (size_t i = 0; i < len; ++i)
+    s.push_back(alphabet[rand() % alphabet.size()]);
+  return s;
+}
+
+// rule i is rules[i], a braced list of literals is taken as string_views
+template <typename Rule = std::string_view>
+std::vector<std::unique_ptr<parsergen::re::Re>> parse_all(
+    const std::vector<Rule>& rules) {
+  std::vector<std::unique_ptr<parsergen::re::Re>> res;
+  for (auto& rule : rules) res.push_back(parsergen::re::Re::parse(rule));
+  return res;
+}
+
+// the dfa of a lexer whose token id i is rules[i]
+inline parsergen::dfa::Dfa lexer_dfa(std::vector<const char*> rules) {
+  return parsergen::dfa::Dfa::from_nfa(
+      parsergen::nfa::Nfa::from_re(parse_all(rules)));
+}
+
+#endif